@@ -0,0 +1,331 @@
+#include "Checks.hpp"
+
+#include "BatchPhysics.hpp"
+#include "LevelIO.hpp"
+#include "LevelStream.hpp"
+#include "SyntheticLevel.hpp"
+#include "Triggers.hpp"
+
+#include <fmt/format.h>
+
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+// ============================================================================
+// HELPERS
+// ============================================================================
+
+// Counts expectations and prints the ones that fail
+struct Checker {
+    const char* name;
+    int checks = 0;
+    int failures = 0;
+
+    template <class... Args>
+    void expect(bool ok, fmt::format_string<Args...> what, Args&&... args) {
+        checks++;
+        if (ok) return;
+        failures++;
+        fmt::print("{}: FAILED {}\n", name, fmt::format(what, std::forward<Args>(args)...));
+    }
+
+    int done() const {
+        fmt::print("{}: {} of {} checks passed\n", name, checks - failures, checks);
+        return failures;
+    }
+};
+
+static std::filesystem::path tempPath(const char* name) {
+    return std::filesystem::temp_directory_path() / name;
+}
+
+static bool near(float a, float b) {
+    return std::abs(a - b) < 0.05f;
+}
+
+// ============================================================================
+// MOTION
+// ============================================================================
+
+// Object IDs that tell the scenario's objects apart once they are sorted
+enum MotionObject : int {
+    MOVER = 9001, TOGGLED, SHARED_A, SHARED_B, TURNER_A, TURNER_B, HIDDEN,
+};
+
+static constexpr float TRIGGER_X = 100;
+static constexpr float PIVOT_X = 600, PIVOT_Y = 200;
+
+// One object per trigger behaviour, each in its own group:
+// - MOVER rises 60 over a second from TRIGGER_X
+// - TOGGLED is off from x 500 to x 800
+// - SHARED_A and SHARED_B move right 90 together, so they share keys
+// - TURNER_A and TURNER_B turn 90 degrees clockwise about the pivot, so
+//   they don't
+// - HIDDEN is toggled off before the start and never collides
+static std::shared_ptr<Level> motionLevel() {
+    auto level = std::make_shared<Level>();
+    level->levelLength = 2000;
+
+    std::vector<GroupList> groups;
+    auto add = [&](int id, float x, float y, bool hazard, uint16_t group) {
+        level->objects.push_back({id, x, y, 30, 30, hazard, !hazard});
+        GroupList g;
+        g.ids[0] = group;
+        g.count = 1;
+        groups.push_back(g);
+    };
+    add(MOVER, 300, 200, true, 1);
+    add(TOGGLED, 400, 120, false, 2);
+    add(SHARED_A, 700, 300, true, 3);
+    add(SHARED_B, 760, 300, true, 3);
+    add(TURNER_A, PIVOT_X + 30, PIVOT_Y, true, 4);
+    add(TURNER_B, PIVOT_X, PIVOT_Y + 60, true, 4);
+    add(HIDDEN, 900, 120, true, 5);
+
+    std::vector<RawTrigger> triggers;
+    RawTrigger rise;
+    rise.x = TRIGGER_X;
+    rise.group = 1;
+    rise.duration = 1;
+    rise.dy = 60;
+    triggers.push_back(rise);
+
+    RawTrigger off;
+    off.kind = TriggerKind::Toggle;
+    off.x = 500;
+    off.group = 2;
+    off.activate = false;
+    triggers.push_back(off);
+    RawTrigger on = off;
+    on.x = 800;
+    on.activate = true;
+    triggers.push_back(on);
+
+    RawTrigger slide;
+    slide.x = TRIGGER_X;
+    slide.group = 3;
+    slide.duration = 0.5f;
+    slide.dx = 90;
+    triggers.push_back(slide);
+
+    RawTrigger turn;
+    turn.kind = TriggerKind::Rotate;
+    turn.x = TRIGGER_X;
+    turn.group = 4;
+    turn.duration = 1;
+    turn.degrees = 90;
+    turn.hasPivot = true;
+    turn.pivotX = PIVOT_X;
+    turn.pivotY = PIVOT_Y;
+    triggers.push_back(turn);
+
+    RawTrigger hide = off;
+    hide.x = 0;
+    hide.group = 5;
+    triggers.push_back(hide);
+
+    level->motion = buildMotion(level->objects, groups, triggers);
+    level->finalize();
+    return level;
+}
+
+static const LevelObject* findObject(const Level& level, int id) {
+    for (auto& o : level.objects) {
+        if (o.id == id) return &o;
+    }
+    return nullptr;
+}
+
+// Expects `id` to be centred on (x, y) for a player at px, or toggled off
+// there if `active` is false
+static void expectAt(Checker& c, const Level& level, int id, float px, bool active, float x = 0, float y = 0) {
+    auto* o = findObject(level, id);
+    if (!o || o->track == NO_TRACK) {
+        c.expect(false, "object {} has a track", id);
+        return;
+    }
+    HitRect r{};
+    bool on = level.motion.sample(o->track, px, r);
+    c.expect(on == active, "object {} is {} at px {:.1f}", id, active ? "active" : "off", px);
+    if (!on || !active) return;
+
+    float cx = r.x + r.w / 2, cy = r.y + r.h / 2;
+    c.expect(near(cx, x) && near(cy, y), "object {} at px {:.1f} is at ({:.2f}, {:.2f}), not ({:.2f}, {:.2f})",
+             id, px, cx, cy, x, y);
+
+    // The object's own box is the sweep of every sampled one
+    HitRect box = o->rect();
+    c.expect(r.x >= box.x - 0.01f && r.x + r.w <= box.x + box.w + 0.01f &&
+             r.y >= box.y - 0.01f && r.y + r.h <= box.y + box.h + 0.01f,
+             "object {} at px {:.1f} stays inside its swept box", id, px);
+}
+
+// The same level hash after every way a level can be saved and rebuilt
+static void expectRoundTrips(Checker& c, const Level& level, const char* what) {
+    uint64_t hash = hashLevel(level);
+
+    auto text = tempPath("pf-check-motion.txt");
+    auto loaded = saveLevelText(text, level) ? loadLevelText(text) : nullptr;
+    c.expect(loaded && hashLevel(*loaded) == hash, "{} keeps its hash through a text file", what);
+
+    auto cache = tempPath("pf-check-motion.bin");
+    auto cached = saveLevelCache(cache, level, 1) ? loadLevelCache(cache, 1) : nullptr;
+    c.expect(cached && hashLevel(*cached) == hash, "{} keeps its hash through the cache", what);
+
+    auto stream = std::make_shared<LevelStream>();
+    stream->start(level.objects, level.motion, level.levelLength);
+    auto streamed = stream->waitComplete();
+    c.expect(streamed && hashLevel(*streamed) == hash, "{} keeps its hash through a stream", what);
+
+    std::error_code ec;
+    std::filesystem::remove(text, ec);
+    std::filesystem::remove(cache, ec);
+}
+
+int checkMotion() {
+    Checker c{"check-motion"};
+    auto level = motionLevel();
+
+    // Seconds of trigger time in player x, at the default speed
+    float v = BatchPhysics::DEFAULT_TICK.xStep * BatchPhysics::DEFAULT_TICK.rate;
+
+    expectAt(c, *level, MOVER, 50, true, 300, 200);
+    expectAt(c, *level, MOVER, TRIGGER_X + v / 2, true, 300, 230);
+    expectAt(c, *level, MOVER, TRIGGER_X + 2 * v, true, 300, 260);
+
+    expectAt(c, *level, TOGGLED, 499.9f, true, 400, 120);
+    expectAt(c, *level, TOGGLED, 500, false);
+    expectAt(c, *level, TOGGLED, 799.9f, false);
+    expectAt(c, *level, TOGGLED, 800, true, 400, 120);
+
+    expectAt(c, *level, SHARED_A, TRIGGER_X + v, true, 790, 300);
+    expectAt(c, *level, SHARED_B, TRIGGER_X + v, true, 850, 300);
+    auto* a = findObject(*level, SHARED_A);
+    auto* b = findObject(*level, SHARED_B);
+    if (a && b && a->track != NO_TRACK && b->track != NO_TRACK) {
+        auto& ta = level->motion.tracks[a->track];
+        auto& tb = level->motion.tracks[b->track];
+        c.expect(a->track != b->track && ta.firstKey == tb.firstKey && ta.keyCount == tb.keyCount,
+                 "objects moved by the same triggers share their keys");
+    }
+
+    // Half way through the turn is a key of its own, 45 degrees in
+    float h = std::sqrt(0.5f);
+    expectAt(c, *level, TURNER_A, 50, true, PIVOT_X + 30, PIVOT_Y);
+    expectAt(c, *level, TURNER_A, TRIGGER_X + v / 2, true, PIVOT_X + 30 * h, PIVOT_Y - 30 * h);
+    expectAt(c, *level, TURNER_A, TRIGGER_X + 2 * v, true, PIVOT_X, PIVOT_Y - 30);
+    expectAt(c, *level, TURNER_B, TRIGGER_X + 2 * v, true, PIVOT_X + 60, PIVOT_Y);
+    auto* ra = findObject(*level, TURNER_A);
+    auto* rb = findObject(*level, TURNER_B);
+    if (ra && rb && ra->track != NO_TRACK && rb->track != NO_TRACK) {
+        c.expect(level->motion.tracks[ra->track].firstKey != level->motion.tracks[rb->track].firstKey,
+                 "turning objects keep keys of their own");
+    }
+
+    c.expect(!findObject(*level, HIDDEN), "a never active object is dropped");
+    c.expect(level->objects.size() == 6, "{} objects are left, not 6", level->objects.size());
+
+    expectRoundTrips(c, *level, "the motion scenario");
+
+    SyntheticParams synth;
+    synth.movers = 8;
+    auto movers = generateLevel(synth);
+    c.expect(!movers->motion.empty(), "the synthetic level has moving spikes");
+    expectRoundTrips(c, *movers, "a synthetic level with movers");
+
+    return c.done();
+}
+
+// ============================================================================
+// CACHE
+// ============================================================================
+
+// Saves `level` with one field broken by `corrupt` and expects the cache
+// loader to refuse it
+static void expectRejected(Checker& c, const Level& level, const char* what,
+                           const std::function<void(Level&)>& corrupt) {
+    auto path = tempPath("pf-check-cache.bin");
+    Level broken = level;
+    corrupt(broken);
+    bool saved = saveLevelCache(path, broken, 1);
+    c.expect(saved && !loadLevelCache(path, 1), "a cache with {} is rejected", what);
+}
+
+// Damages the bytes of a saved cache and expects the loader to refuse it
+static void expectRejectedFile(Checker& c, const Level& level, const char* what,
+                               const std::function<void(const std::filesystem::path&)>& damage,
+                               uint64_t key = 1) {
+    auto path = tempPath("pf-check-cache.bin");
+    bool saved = saveLevelCache(path, level, 1);
+    damage(path);
+    c.expect(saved && !loadLevelCache(path, key), "a cache file with {} is rejected", what);
+}
+
+static void overwrite(const std::filesystem::path& path, std::streamoff at, char byte) {
+    std::fstream f(path, std::ios::binary | std::ios::in | std::ios::out);
+    f.seekp(at);
+    f.put(byte);
+}
+
+int checkCache() {
+    Checker c{"check-cache"};
+
+    SyntheticParams synth;
+    synth.movers = 8;
+    auto level = generateLevel(synth);
+    auto path = tempPath("pf-check-cache.bin");
+
+    auto loaded = saveLevelCache(path, *level, 1) ? loadLevelCache(path, 1) : nullptr;
+    c.expect(loaded && hashLevel(*loaded) == hashLevel(*level), "a clean cache loads with the same hash");
+    c.expect(loaded && loaded->index.colStart == level->index.colStart &&
+             loaded->index.colItems == level->index.colItems &&
+             loaded->index.firstCol == level->index.firstCol &&
+             loaded->occupancy.hazard == level->occupancy.hazard &&
+             loaded->occupancy.solid == level->occupancy.solid,
+             "a clean cache loads the same index and grid");
+
+    Level empty;
+    auto emptyLoaded = saveLevelCache(path, empty, 1) ? loadLevelCache(path, 1) : nullptr;
+    c.expect(emptyLoaded && emptyLoaded->objects.empty(), "an empty level loads");
+
+    uint32_t objects = static_cast<uint32_t>(level->objects.size());
+    expectRejected(c, *level, "an item past the last object",
+                   [&](Level& l) { l.index.colItems[3] = objects; });
+    expectRejected(c, *level, "a huge item", [](Level& l) { l.index.colItems[3] = 1u << 30; });
+    expectRejected(c, *level, "a negative first column", [](Level& l) { l.index.firstCol[3] = -1; });
+    expectRejected(c, *level, "a first column past the index",
+                   [](Level& l) { l.index.firstCol[3] = l.index.columns(); });
+    expectRejected(c, *level, "a column start going backwards",
+                   [](Level& l) { l.index.colStart[5] = l.index.colStart[4] - 1; });
+    expectRejected(c, *level, "a column start past the items",
+                   [](Level& l) { l.index.colStart.back()++; });
+    expectRejected(c, *level, "a missing column start", [](Level& l) { l.index.colStart.pop_back(); });
+    expectRejected(c, *level, "more grid rows than bits",
+                   [](Level& l) { l.occupancy.rows = l.occupancy.words * 64 + 1; });
+    expectRejected(c, *level, "negative grid columns", [](Level& l) { l.occupancy.cols = -1; });
+    expectRejected(c, *level, "a track without keys", [](Level& l) { l.motion.tracks[0].keyCount = 0; });
+    expectRejected(c, *level, "a track past the last key",
+                   [](Level& l) { l.motion.tracks[0].firstKey = static_cast<uint32_t>(l.motion.keys.size()); });
+
+    expectRejectedFile(c, *level, "a bad magic", [](auto& p) { overwrite(p, 0, 'X'); });
+    expectRejectedFile(c, *level, "an unknown version", [](auto& p) { overwrite(p, 8, 99); });
+    expectRejectedFile(c, *level, "a different key", [](auto&) {}, 2);
+    expectRejectedFile(c, *level, "its last byte cut off", [](auto& p) {
+        std::error_code ec;
+        std::filesystem::resize_file(p, std::filesystem::file_size(p, ec) - 1, ec);
+    });
+    expectRejectedFile(c, *level, "only its 56 byte header", [](auto& p) {
+        std::error_code ec;
+        std::filesystem::resize_file(p, 56, ec);
+    });
+
+    std::error_code ec;
+    std::filesystem::remove(path, ec);
+    return c.done();
+}
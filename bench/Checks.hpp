@@ -0,0 +1,17 @@
+#pragma once
+
+// ============================================================================
+// SELF CHECKS
+// ============================================================================
+
+// Fixed scenarios with known answers, run by pf-bench in CI. Each prints
+// every failed expectation and returns how many there were.
+
+// Motion tracks: sampled positions of moved, turned and toggled objects,
+// keys shared between objects moved alike, never active objects dropped,
+// and the level hash after a text, cache and streamed round trip
+int checkMotion();
+
+// Level cache: a clean level loads back unchanged, and every corrupt field
+// or damaged file is rejected instead of loaded
+int checkCache();
@@ -0,0 +1,131 @@
+#include "SyntheticLevel.hpp"
+
+#include "BatchPhysics.hpp"
+#include "Physics.hpp"
+#include "Triggers.hpp"
+
+#include <iterator>
+#include <random>
+#include <vector>
+
+// Floor the player stands on, and the spike hitbox used by the generator
+static constexpr float FLOOR_Y = BatchPhysics::GROUND_Y - 12;
+static constexpr float SPIKE_W = 6;
+static constexpr float SPIKE_H = 12;
+
+// Block columns kept clear at the start so every run begins on flat ground
+static constexpr int SAFE_COLUMNS = 10;
+
+// Portals span the whole playable height so no state can miss them
+static constexpr float PORTAL_W = 10;
+static constexpr float PORTAL_H = BatchPhysics::CEILING_Y - FLOOR_Y;
+
+// Movers start rising this far ahead of their column
+static constexpr float MOVER_LEAD = 6 * Physics::BLOCK;
+static constexpr float MOVER_RISE = 1;
+
+// Every other portal returns to cube; the rest go through these in turn
+static constexpr struct {
+    int id;
+    Portal portal;
+} PORTAL_CYCLE[] = {
+    {13, Portal::Ship}, {47, Portal::Ball}, {111, Portal::Ufo}, {660, Portal::Wave},
+    {745, Portal::Robot}, {1331, Portal::Spider}, {1933, Portal::Swing},
+};
+
+std::shared_ptr<Level> generateLevel(const SyntheticParams& params) {
+    auto level = std::make_shared<Level>();
+    level->levelLength = params.length;
+    
+    int columns = static_cast<int>(params.length / Physics::BLOCK);
+    std::vector<bool> used(columns, false);
+    
+    // Groups of every object so far, for the triggers below
+    std::vector<GroupList> groups;
+    
+    auto addBlock = [&](int col, int row) {
+        float cx = col * Physics::BLOCK + Physics::BLOCK / 2;
+        float cy = FLOOR_Y + Physics::BLOCK / 2 + row * Physics::BLOCK;
+        level->objects.push_back({1, cx, cy, Physics::BLOCK, Physics::BLOCK, false, true});
+    };
+    
+    // Staircases evenly spaced after the safe zone, one column gap each side
+    if (params.stairs > 0 && columns > SAFE_COLUMNS) {
+        int span = (columns - SAFE_COLUMNS) / params.stairs;
+        for (int s = 0; s < params.stairs; s++) {
+            int start = SAFE_COLUMNS + s * span + span / 2;
+            for (int step = 0; step < params.stairHeight && start + step < columns; step++) {
+                for (int row = 0; row <= step; row++) addBlock(start + step, row);
+            }
+            for (int c = start - 1; c <= start + params.stairHeight && c < columns; c++) {
+                if (c >= 0) used[c] = true;
+            }
+        }
+    }
+    
+    // Portals evenly spaced, in the middle of a cleared column
+    if (params.portals > 0 && columns > SAFE_COLUMNS) {
+        int span = (columns - SAFE_COLUMNS) / (params.portals + 1);
+        for (int p = 0; p < params.portals; p++) {
+            int col = SAFE_COLUMNS + (p + 1) * span;
+            if (col >= columns) break;
+            
+            int id = 12;
+            Portal portal = Portal::Cube;
+            if (p % 2 == 0) {
+                auto& next = PORTAL_CYCLE[(p / 2) % std::size(PORTAL_CYCLE)];
+                id = next.id;
+                portal = next.portal;
+            }
+            float cx = col * Physics::BLOCK + Physics::BLOCK / 2;
+            level->objects.push_back({id, cx, FLOOR_Y + PORTAL_H / 2, PORTAL_W, PORTAL_H, false, false, portal});
+            for (int c = col - 1; c <= col + 1 && c < columns; c++) used[c] = true;
+        }
+    }
+    
+    // Movers start sunk into the floor, rise while the player approaches
+    // and are toggled off once it has passed
+    std::vector<RawTrigger> triggers;
+    if (params.movers > 0 && columns > SAFE_COLUMNS) {
+        int span = (columns - SAFE_COLUMNS) / (params.movers + 1);
+        for (int m = 0; m < params.movers; m++) {
+            int col = SAFE_COLUMNS + (m + 1) * span + span / 2;
+            if (col >= columns || used[col]) continue;
+            
+            int group = m + 1;
+            float cx = col * Physics::BLOCK + Physics::BLOCK / 2;
+            level->objects.push_back({8, cx, FLOOR_Y - SPIKE_H / 2, SPIKE_W, SPIKE_H, true, false});
+            groups.resize(level->objects.size());
+            groups.back().ids[0] = static_cast<uint16_t>(group);
+            groups.back().count = 1;
+            
+            RawTrigger rise;
+            rise.x = cx - MOVER_LEAD;
+            rise.group = group;
+            rise.duration = MOVER_RISE;
+            rise.dy = SPIKE_H;
+            triggers.push_back(rise);
+            
+            RawTrigger off;
+            off.kind = TriggerKind::Toggle;
+            off.x = cx + 2 * Physics::BLOCK;
+            off.group = group;
+            off.activate = false;
+            triggers.push_back(off);
+            used[col] = true;
+        }
+    }
+    
+    std::mt19937 rng(params.seed);
+    std::uniform_real_distribution<float> roll(0.0f, 1.0f);
+    for (int c = SAFE_COLUMNS; c < columns; c++) {
+        if (used[c] || roll(rng) >= params.spikeDensity) continue;
+        float cx = c * Physics::BLOCK + Physics::BLOCK / 2;
+        level->objects.push_back({8, cx, FLOOR_Y + SPIKE_H / 2, SPIKE_W, SPIKE_H, true, false});
+    }
+    
+    groups.resize(level->objects.size());
+    level->motion = buildMotion(level->objects, groups, triggers);
+    level->finalize();
+    return level;
+}
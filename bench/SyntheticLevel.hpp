@@ -0,0 +1,26 @@
+#pragma once
+
+#include "Level.hpp"
+
+#include <cstdint>
+#include <memory>
+
+// ============================================================================
+// SYNTHETIC LEVELS
+// ============================================================================
+
+// The defaults make a level that every search mode solves in about a
+// second, so the plain benchmark always reports a time to solution
+struct SyntheticParams {
+    float length = 3000;          // level length in units
+    float spikeDensity = 0.1f;    // chance of a spike per free block column
+    int stairs = 4;               // block staircases spread over the level
+    int stairHeight = 3;          // steps per staircase
+    int portals = 4;              // full-height portals, alternating other modes with cube
+    int movers = 0;               // spikes a move trigger raises out of the floor
+    uint32_t seed = 1;
+};
+
+// Ground spikes, block stairs, portals and triggered spikes on flat
+// ground, deterministic per seed
+std::shared_ptr<Level> generateLevel(const SyntheticParams& params);
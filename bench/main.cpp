@@ -0,0 +1,326 @@
+// Headless pathfinder benchmark.
+//
+//   pf-bench --level last-level.txt --width 3000
+//   pf-bench --length 6000 --spikes 0.15 --stairs 4 --runs 5
+//   pf-bench --level last-level.txt --replay solution.gdr
+//   pf-bench --check-motion --check-cache
+//
+// Exits non-zero if a run doesn't solve the level, unless runs are cut
+// short with --stop-after, or if a self check fails.
+
+#include "Checks.hpp"
+#include "LevelIO.hpp"
+#include "Log.hpp"
+#include "Pathfinder.hpp"
+#include "Replay.hpp"
+#include "SyntheticLevel.hpp"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+// ============================================================================
+// HELPERS
+// ============================================================================
+
+static double peakMemoryMB() {
+#if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS pmc;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc))) return 0;
+    return pmc.PeakWorkingSetSize / (1024.0 * 1024.0);
+#else
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+#if defined(__APPLE__)
+    return usage.ru_maxrss / (1024.0 * 1024.0);   // bytes
+#else
+    return usage.ru_maxrss / 1024.0;              // kilobytes
+#endif
+#endif
+}
+
+static void quietSink(Log::Level level, const std::string& msg) {
+    if (level >= Log::Level::Warn) std::fprintf(stderr, "%s\n", msg.c_str());
+}
+
+static void usage() {
+    std::fprintf(stderr,
+        "usage: pf-bench [options]\n"
+        "  --level FILE      load a level exported by the mod (.txt or cached .bin)\n"
+        "  --length N        synthetic level length in units (default 3000)\n"
+        "  --spikes F        synthetic spike chance per block column (default 0.1)\n"
+        "  --stairs N        synthetic block staircases (default 4)\n"
+        "  --portals N       synthetic full-height portals (default 4)\n"
+        "  --movers N        synthetic spikes raised by move triggers (default 0)\n"
+        "  --seed N          synthetic level seed (default 1)\n"
+        "  --width N         beam width (default 3000)\n"
+        "  --threads N       worker threads, 0 = all cores (default 0)\n"
+        "  --fixed           disable adaptive beam sizing\n"
+        "  --memory-cap N    hard search memory limit in MB (default 1024)\n"
+        "  --tick N          simulation ticks per second (default 240)\n"
+        "  --segmented       solve segments between landmarks in parallel\n"
+        "  --decisions       only branch where a click matters\n"
+        "  --stream          search while the level is still being built in chunks\n"
+        "  --heuristic NAME  beam ranking: progress or guided (default progress)\n"
+        "  --lookahead N     guided survival lookahead in frames (default 60)\n"
+        "  --no-danger       don't prune with the precomputed danger map\n"
+        "  --no-refine       save and report the solution as found, unrefined\n"
+        "  --refine-ticks N  ticks each press is moved either way when refining (default 3)\n"
+        "  --checkpoint FILE checkpoint the search to FILE\n"
+        "  --interval N      seconds between checkpoints, 0 = only when stopped (default 60)\n"
+        "  --resume          continue from the --checkpoint file\n"
+        "  --from-replay FILE follow a saved replay and only search where it stops working\n"
+        "  --save-replay FILE write the solution of the last run to FILE\n"
+        "  --replay FILE     check that a saved replay still completes the level\n"
+        "  --save-level FILE write the level to FILE as text instead of searching\n"
+        "  --runs N          repeat the search N times (default 1)\n"
+        "  --stop-after S    stop each run after S seconds and report how long stopping took\n"
+        "  --check-motion    run the motion track self checks instead of a search\n"
+        "  --check-cache     run the level cache self checks instead of a search\n"
+        "  --verbose         show the search log\n");
+}
+
+// Replays a saved solution through the reference step. Exits non-zero if
+// the player dies or stops short, so saved solutions work as regression
+// checks for physics changes.
+static int checkReplay(const std::string& path, const Level& level) {
+    auto t0 = std::chrono::steady_clock::now();
+    Replay replay;
+    if (!replay.load(path)) {
+        std::fprintf(stderr, "Can't load replay %s\n", path.c_str());
+        return 1;
+    }
+    double loadSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    
+    auto& info = replay.info();
+    fmt::print("replay: {}  frames: {} at {} ticks/s  encoded: {} bytes  load: {:.6f}s\n",
+               path, replay.frames(), info.tickRate, replay.encodedSize(), loadSeconds);
+    if (info.levelHash != 0 && info.levelHash != hashLevel(level)) {
+        fmt::print("warning: replay was recorded on a different level\n");
+    }
+    if (info.physicsVersion != Physics::VERSION) {
+        fmt::print("warning: replay uses physics version {} (current {})\n", info.physicsVersion, Physics::VERSION);
+    }
+    
+    auto tick = BatchPhysics::Tick::at(std::clamp(info.tickRate, BatchPhysics::MIN_TICK_RATE, BatchPhysics::MAX_TICK_RATE));
+    SimState s;
+    for (auto c = replay.cursor(); !c.done() && !s.dead; c.advance()) {
+        SimplePathfinder::simulateFrame(s, c.held(), level, tick);
+    }
+    bool ok = !s.dead && s.x >= level.levelLength + 50;
+    fmt::print("result: {} at x {:.1f} (frame {})\n", ok ? "completes" : s.dead ? "dies" : "stops short", s.x, s.frame);
+    return ok ? 0 : 1;
+}
+
+// ============================================================================
+// MAIN
+// ============================================================================
+
+struct RunResult {
+    double seconds = 0;
+    SearchSnapshot snap;
+};
+
+int main(int argc, char** argv) {
+    std::string levelFile;
+    SyntheticParams synth;
+    SearchConfig cfg;
+    int runs = 1;
+    double stopAfter = 0;
+    bool verbose = false;
+    bool resume = false;
+    bool stream = false;
+    bool motionChecks = false;
+    bool cacheChecks = false;
+    std::string saveReplay;
+    std::string replayFile;
+    std::string seedFile;
+    std::string saveLevel;
+    
+    for (int i = 1; i < argc; i++) {
+        auto is = [&](const char* name) { return std::strcmp(argv[i], name) == 0; };
+        auto value = [&]() -> const char* {
+            if (i + 1 >= argc) {
+                std::fprintf(stderr, "%s needs a value\n", argv[i]);
+                std::exit(2);
+            }
+            return argv[++i];
+        };
+        
+        if (is("--level")) levelFile = value();
+        else if (is("--length")) synth.length = std::strtof(value(), nullptr);
+        else if (is("--spikes")) synth.spikeDensity = std::strtof(value(), nullptr);
+        else if (is("--stairs")) synth.stairs = std::atoi(value());
+        else if (is("--portals")) synth.portals = std::atoi(value());
+        else if (is("--movers")) synth.movers = std::atoi(value());
+        else if (is("--seed")) synth.seed = static_cast<uint32_t>(std::strtoul(value(), nullptr, 10));
+        else if (is("--width")) cfg.beamWidth = std::atoi(value());
+        else if (is("--threads")) cfg.workerThreads = std::atoi(value());
+        else if (is("--fixed")) cfg.adaptiveBeam = false;
+        else if (is("--memory-cap")) cfg.memoryCapMB = std::atoi(value());
+        else if (is("--tick")) cfg.tickRate = std::atoi(value());
+        else if (is("--segmented")) cfg.segmented = true;
+        else if (is("--decisions")) cfg.decisionPoints = true;
+        else if (is("--stream")) stream = true;
+        else if (is("--heuristic")) cfg.heuristic.kind = heuristicFromName(value());
+        else if (is("--lookahead")) cfg.heuristic.lookaheadFrames = std::atoi(value());
+        else if (is("--no-danger")) cfg.dangerMap = false;
+        else if (is("--no-refine")) cfg.refine = false;
+        else if (is("--refine-ticks")) cfg.refineTicks = std::max(1, std::atoi(value()));
+        else if (is("--checkpoint")) cfg.checkpointPath = value();
+        else if (is("--interval")) cfg.checkpointSeconds = std::atoi(value());
+        else if (is("--resume")) resume = true;
+        else if (is("--from-replay")) seedFile = value();
+        else if (is("--save-replay")) saveReplay = value();
+        else if (is("--replay")) replayFile = value();
+        else if (is("--save-level")) saveLevel = value();
+        else if (is("--runs")) runs = std::max(1, std::atoi(value()));
+        else if (is("--stop-after")) stopAfter = std::strtod(value(), nullptr);
+        else if (is("--check-motion")) motionChecks = true;
+        else if (is("--check-cache")) cacheChecks = true;
+        else if (is("--verbose")) verbose = true;
+        else {
+            usage();
+            return is("--help") ? 0 : 2;
+        }
+    }
+    
+    if (!verbose) Log::setSink(quietSink);
+    if (motionChecks || cacheChecks) {
+        int failures = (motionChecks ? checkMotion() : 0) + (cacheChecks ? checkCache() : 0);
+        return failures == 0 ? 0 : 1;
+    }
+    
+    auto loadStart = std::chrono::steady_clock::now();
+    std::shared_ptr<Level> level;
+    if (levelFile.empty()) {
+        level = generateLevel(synth);
+    } else if (std::filesystem::path(levelFile).extension() == ".bin") {
+        level = loadLevelCache(levelFile);
+        if (!level) std::fprintf(stderr, "Can't load level cache %s\n", levelFile.c_str());
+    } else {
+        level = loadLevelText(levelFile);
+    }
+    if (!level) return 1;
+    double loadSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - loadStart).count();
+    
+    if (levelFile.empty()) {
+        fmt::print("level: synthetic length={} spikes={} stairs={} seed={}\n",
+                   synth.length, synth.spikeDensity, synth.stairs, synth.seed);
+    } else {
+        fmt::print("level: {}\n", levelFile);
+    }
+    fmt::print("objects: {}  length: {:.0f}  load: {:.3f}s\n", level->objects.size(), level->levelLength, loadSeconds);
+    if (!replayFile.empty()) return checkReplay(replayFile, *level);
+    if (!saveLevel.empty()) return saveLevelText(saveLevel, *level) ? 0 : 1;
+    
+    fmt::print("beam width: {} ({})  threads: {}  ticks/s: {}  heuristic: {}{}{}\n",
+               cfg.beamWidth, cfg.adaptiveBeam ? "adaptive" : "fixed", cfg.threadCount(), cfg.tickRate,
+               heuristicName(cfg.heuristic.kind), cfg.segmented ? "  segmented" : "",
+               cfg.decisionPoints ? "  decision points" : "");
+    
+    // A seed only replays correctly at the rate it was recorded at
+    std::vector<bool> seed;
+    if (!seedFile.empty()) {
+        Replay replay;
+        if (!replay.load(seedFile)) {
+            std::fprintf(stderr, "Can't load replay %s\n", seedFile.c_str());
+            return 1;
+        }
+        if (replay.info().tickRate != cfg.tickRate) {
+            std::fprintf(stderr, "Replay %s was recorded at %d ticks/s, not %d\n",
+                         seedFile.c_str(), replay.info().tickRate, cfg.tickRate);
+            return 1;
+        }
+        seed = replay.inputs();
+        fmt::print("seed: {} ({} frames)\n", seedFile, seed.size());
+    }
+    
+    SimplePathfinder pf;
+    std::vector<RunResult> results;
+    
+    for (int r = 0; r < runs; r++) {
+        auto t0 = std::chrono::steady_clock::now();
+        if (stream) {
+            // The level is rebuilt from its objects alongside the search
+            auto levelStream = std::make_shared<LevelStream>();
+            levelStream->start(level->objects, level->motion, level->levelLength);
+            if (!pf.start(levelStream, cfg)) return 1;
+            pf.wait();
+        } else if (stopAfter > 0) {
+            // Stop latency: from the request to the search's stop callback
+            bool started = seed.empty() ? pf.start(level, cfg, resume) : pf.start(level, cfg, seed);
+            if (!started) return 1;
+            std::this_thread::sleep_for(std::chrono::duration<double>(stopAfter));
+            auto requested = std::chrono::steady_clock::now();
+            std::chrono::steady_clock::time_point stopped;
+            pf.requestStop([&]() { stopped = std::chrono::steady_clock::now(); });
+            pf.wait();
+            if (stopped == std::chrono::steady_clock::time_point()) stopped = requested;
+            fmt::print("stop latency: {:.2f} ms\n",
+                       std::chrono::duration<double, std::milli>(stopped - requested).count());
+        } else if (!seed.empty()) {
+            if (!pf.run(level, cfg, seed)) return 1;
+        } else if (!pf.run(level, cfg, resume)) {
+            return 1;
+        }
+        RunResult res;
+        res.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        res.snap = pf.latest();
+        results.push_back(res);
+        
+        auto& s = res.snap;
+        fmt::print("run {}: {} frames={} time={:.3f}s frames/s={:.0f} states/s={:.0f} nodes={} progress={:.1f}%\n",
+                   r + 1, s.found ? "solved" : "failed", s.frame, res.seconds,
+                   s.frame / res.seconds, s.stats.expanded / res.seconds, s.nodes, s.progress * 100);
+        fmt::print("  {}\n", s.stats.logLine(s.frame));
+        if (s.margin >= 0) {
+            fmt::print("  refined: worst margin {} of {} ticks\n", s.margin, cfg.refineTicks);
+        }
+    }
+    
+    std::sort(results.begin(), results.end(), [](auto& a, auto& b) { return a.seconds < b.seconds; });
+    auto& median = results[results.size() / 2];
+    
+    fmt::print("median: time={:.3f}s frames/s={:.0f} states/s={:.0f}\n",
+               median.seconds, median.snap.frame / median.seconds, median.snap.stats.expanded / median.seconds);
+    if (median.snap.found) {
+        fmt::print("time to solution: {:.3f}s ({} inputs)\n", median.seconds, median.snap.prefix.size());
+    } else {
+        fmt::print("time to solution: n/a (best progress {:.1f}%)\n", median.snap.progress * 100);
+    }
+    fmt::print("peak memory: {:.1f} MB\n", peakMemoryMB());
+    
+    if (!saveReplay.empty()) {
+        auto& last = pf.latest();
+        if (!last.found) {
+            std::fprintf(stderr, "No solution to save\n");
+            return 1;
+        }
+        Replay replay;
+        replay.assign(last.solution());
+        replay.info().levelHash = hashLevel(*level);
+        replay.info().tickRate = last.tickRate;
+        if (!replay.save(saveReplay)) return 1;
+        fmt::print("replay: {} frames in {} bytes\n", replay.frames(), replay.encodedSize());
+    }
+    
+    bool allSolved = std::all_of(results.begin(), results.end(), [](auto& r) { return r.snap.found; });
+    return allSolved || stopAfter > 0 ? 0 : 1;
+}
@@ -0,0 +1,171 @@
+// Headless solve queue for a catalogue of levels.
+//
+//   pf-solve --results results.log --replays solutions/ levels/*.txt
+//   pf-solve --cache-dir <mod save dir>/cache --list catalogue.txt
+//
+// Each level is a level file exported by the mod (.txt), a level cache
+// (.bin), or a level ID looked up in --cache-dir.
+
+#include "Log.hpp"
+#include "SolveQueue.hpp"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+static void quietSink(Log::Level level, const std::string& msg) {
+    if (level >= Log::Level::Warn) std::fprintf(stderr, "%s\n", msg.c_str());
+}
+
+static void usage() {
+    std::fprintf(stderr,
+        "usage: pf-solve [options] LEVEL...\n"
+        "  LEVEL             level file (.txt), level cache (.bin) or level ID\n"
+        "  --list FILE       read more levels from FILE, one per line\n"
+        "  --cache-dir DIR   where level IDs are looked up (the mod's cache folder)\n"
+        "  --results FILE    append one line per level to FILE (default results.log)\n"
+        "  --replays DIR     save solutions to DIR as <level>.gdr\n"
+        "  --jobs N          levels solved at once, 0 = all cores (default 0)\n"
+        "  --threads N       worker threads per level (default 1)\n"
+        "  --width N         beam width (default 3000)\n"
+        "  --fixed           disable adaptive beam sizing\n"
+        "  --memory-cap N    memory limit in MB, shared by all levels (default 1024)\n"
+        "  --tick N          simulation ticks per second (default 240)\n"
+        "  --segmented       solve segments between landmarks in parallel\n"
+        "  --decisions       only branch where a click matters\n"
+        "  --heuristic NAME  beam ranking: progress or guided (default progress)\n"
+        "  --no-danger       don't prune with the precomputed danger map\n"
+        "  --no-refine       save solutions as found, unrefined\n"
+        "  --verbose         show the search log\n");
+}
+
+static bool isLevelId(const std::string& s) {
+    return !s.empty() && std::all_of(s.begin(), s.end(), [](char c) { return c >= '0' && c <= '9'; });
+}
+
+// One level per line; blank lines and lines starting with '#' are skipped
+static bool readList(const char* path, std::vector<std::string>& levels) {
+    std::ifstream list(path);
+    if (!list) {
+        std::fprintf(stderr, "Can't read level list %s\n", path);
+        return false;
+    }
+    for (std::string line; std::getline(list, line);) {
+        line.erase(0, line.find_first_not_of(" \t"));
+        line.erase(line.find_last_not_of(" \t\r") + 1);
+        if (!line.empty() && line[0] != '#') levels.push_back(line);
+    }
+    return true;
+}
+
+// The mod names caches <id>-<key>.bin; a level updated online leaves
+// older keys behind, so the newest one wins
+static std::filesystem::path findCache(const std::filesystem::path& dir, const std::string& id) {
+    std::filesystem::path best;
+    std::filesystem::file_time_type bestTime;
+    std::error_code ec;
+    auto prefix = id + "-";
+    for (auto& entry : std::filesystem::directory_iterator(dir, ec)) {
+        auto name = entry.path().filename().string();
+        if (name.rfind(prefix, 0) != 0 || entry.path().extension() != ".bin") continue;
+        auto time = entry.last_write_time(ec);
+        if (best.empty() || time > bestTime) {
+            best = entry.path();
+            bestTime = time;
+        }
+    }
+    return best;
+}
+
+int main(int argc, char** argv) {
+    QueueConfig cfg;
+    cfg.search.workerThreads = 1;
+    cfg.resultsPath = "results.log";
+    std::filesystem::path cacheDir;
+    std::vector<std::string> levels;
+    bool verbose = false;
+    
+    for (int i = 1; i < argc; i++) {
+        auto is = [&](const char* name) { return std::strcmp(argv[i], name) == 0; };
+        auto value = [&]() -> const char* {
+            if (i + 1 >= argc) {
+                std::fprintf(stderr, "%s needs a value\n", argv[i]);
+                std::exit(2);
+            }
+            return argv[++i];
+        };
+        
+        if (is("--list")) {
+            if (!readList(value(), levels)) return 1;
+        }
+        else if (is("--cache-dir")) cacheDir = value();
+        else if (is("--results")) cfg.resultsPath = value();
+        else if (is("--replays")) cfg.replayDir = value();
+        else if (is("--jobs")) cfg.parallel = std::max(0, std::atoi(value()));
+        else if (is("--threads")) cfg.search.workerThreads = std::max(1, std::atoi(value()));
+        else if (is("--width")) cfg.search.beamWidth = std::atoi(value());
+        else if (is("--fixed")) cfg.search.adaptiveBeam = false;
+        else if (is("--memory-cap")) cfg.search.memoryCapMB = std::atoi(value());
+        else if (is("--tick")) cfg.search.tickRate = std::atoi(value());
+        else if (is("--segmented")) cfg.search.segmented = true;
+        else if (is("--decisions")) cfg.search.decisionPoints = true;
+        else if (is("--heuristic")) cfg.search.heuristic.kind = heuristicFromName(value());
+        else if (is("--no-danger")) cfg.search.dangerMap = false;
+        else if (is("--no-refine")) cfg.search.refine = false;
+        else if (is("--verbose")) verbose = true;
+        else if (argv[i][0] != '-') levels.push_back(argv[i]);
+        else {
+            usage();
+            return is("--help") ? 0 : 2;
+        }
+    }
+    
+    if (!verbose) Log::setSink(quietSink);
+    if (levels.empty()) {
+        usage();
+        return 2;
+    }
+    
+    // Levels that can't be found still get a result line, as unreadable
+    std::vector<SolveJob> jobs;
+    for (auto& level : levels) {
+        SolveJob job;
+        if (isLevelId(level)) {
+            job.name = level;
+            job.levelPath = cacheDir.empty() ? std::filesystem::path() : findCache(cacheDir, level);
+            if (job.levelPath.empty()) std::fprintf(stderr, "No cached level for ID %s\n", level.c_str());
+        } else {
+            job.name = std::filesystem::path(level).stem().string();
+            job.levelPath = level;
+        }
+        jobs.push_back(job);
+    }
+    
+    fmt::print("levels: {}  at once: {}  threads per level: {}  beam width: {}  ticks/s: {}\n",
+               jobs.size(), std::min<size_t>(cfg.parallelLevels(), jobs.size()), cfg.search.threadCount(),
+               cfg.search.beamWidth, cfg.search.tickRate);
+    
+    SolveQueue queue(cfg);
+    auto t0 = std::chrono::steady_clock::now();
+    auto results = queue.run(jobs, [](const SolveResult& r) {
+        fmt::print("{}: {} in {:.3f}s  nodes={} expanded={} progress={:.1f}%\n", r.name,
+                   !r.loaded ? "unreadable" : r.solved ? "solved" : "failed",
+                   r.searchSeconds, r.nodes, r.expanded, r.progress * 100);
+        std::fflush(stdout);
+    });
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    
+    size_t solved = std::count_if(results.begin(), results.end(), [](auto& r) { return r.solved; });
+    fmt::print("solved: {} of {}  time: {:.3f}s  levels/min: {:.1f}\n",
+               solved, results.size(), seconds, results.size() * 60 / seconds);
+    if (!cfg.resultsPath.empty()) fmt::print("results: appended to {}\n", cfg.resultsPath.string());
+    return solved == results.size() ? 0 : 1;
+}
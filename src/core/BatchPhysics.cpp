@@ -0,0 +1,205 @@
+#include "BatchPhysics.hpp"
+
+#include <array>
+#include <utility>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define PF_SIMD_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#if defined(__GNUC__) || defined(__clang__)
+#define PF_TARGET_AVX2 __attribute__((target("avx2")))
+#define PF_TARGET_XSAVE __attribute__((target("xsave")))
+#else
+#define PF_TARGET_AVX2
+#define PF_TARGET_XSAVE
+#endif
+#if defined(_MSC_VER)
+PF_TARGET_XSAVE static inline unsigned long long pfReadXCR0() { return _xgetbv(0); }
+#endif
+#elif defined(__ARM_NEON) || defined(__aarch64__) || defined(_M_ARM64)
+#define PF_SIMD_NEON 1
+#include <arm_neon.h>
+#endif
+
+#ifndef PF_SIMD_X86
+#define PF_SIMD_X86 0
+#endif
+#ifndef PF_SIMD_NEON
+#define PF_SIMD_NEON 0
+#endif
+
+// The vector kernels only cover the plain cube (variant 0), the mode
+// nearly every level spends most of its length in
+namespace BatchPhysics {
+#if PF_SIMD_X86
+    PF_TARGET_AVX2 static void stepAVX2(float* x, float* y, float* v, uint32_t* f, size_t n, const Tick& t) {
+        const __m256 gravity = _mm256_set1_ps(t.gravityStep);
+        const __m256 jumpVel = _mm256_set1_ps(Physics::JUMP_VEL);
+        const __m256 velScale = _mm256_set1_ps(t.velScale);
+        const __m256 xStep = _mm256_set1_ps(t.xStep);
+        const __m256 groundY = _mm256_set1_ps(GROUND_Y);
+        const __m256 maxVel = _mm256_set1_ps(MAX_VEL);
+        const __m256 minVel = _mm256_set1_ps(-MAX_VEL);
+        const __m256i groundBit = _mm256_set1_epi32(StateFlags::GROUND);
+        const __m256i clickBit = _mm256_set1_epi32(StateFlags::CLICK);
+        const __m256i heldBit = _mm256_set1_epi32(StateFlags::HELD);
+        const __m256i jumpBits = _mm256_set1_epi32(StateFlags::GROUND | StateFlags::CLICK);
+        
+        size_t i = 0;
+        for (; i + 8 <= n; i += 8) {
+            __m256 vx = _mm256_loadu_ps(x + i);
+            __m256 vy = _mm256_loadu_ps(y + i);
+            __m256 vv = _mm256_loadu_ps(v + i);
+            __m256i fl = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(f + i));
+            
+            vv = _mm256_sub_ps(vv, gravity);
+            
+            __m256i jump = _mm256_cmpeq_epi32(_mm256_and_si256(fl, jumpBits), jumpBits);
+            vv = _mm256_blendv_ps(vv, jumpVel, _mm256_castsi256_ps(jump));
+            fl = _mm256_andnot_si256(_mm256_and_si256(jump, groundBit), fl);
+            
+            vy = _mm256_add_ps(vy, _mm256_mul_ps(vv, velScale));
+            vx = _mm256_add_ps(vx, xStep);
+            
+            vv = _mm256_min_ps(_mm256_max_ps(vv, minVel), maxVel);
+            
+            __m256 hit = _mm256_cmp_ps(vy, groundY, _CMP_LE_OQ);
+            vy = _mm256_blendv_ps(vy, groundY, hit);
+            vv = _mm256_andnot_ps(hit, vv);
+            fl = _mm256_or_si256(fl, _mm256_and_si256(_mm256_castps_si256(hit), groundBit));
+            
+            fl = _mm256_or_si256(_mm256_andnot_si256(heldBit, fl), _mm256_slli_epi32(_mm256_and_si256(fl, clickBit), 1));
+            
+            _mm256_storeu_ps(x + i, vx);
+            _mm256_storeu_ps(y + i, vy);
+            _mm256_storeu_ps(v + i, vv);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(f + i), fl);
+        }
+        stepScalar<0>(x + i, y + i, v + i, f + i, n - i, t);
+    }
+    
+    static bool cpuHasAVX2() {
+#if defined(_MSC_VER)
+        int info[4];
+        __cpuid(info, 0);
+        if (info[0] < 7) return false;
+        __cpuid(info, 1);
+        bool osxsave = (info[2] & (1 << 27)) != 0;
+        bool avx = (info[2] & (1 << 28)) != 0;
+        if (!osxsave || !avx || (pfReadXCR0() & 0x6) != 0x6) return false;
+        __cpuidex(info, 7, 0);
+        return (info[1] & (1 << 5)) != 0;
+#else
+        return __builtin_cpu_supports("avx2");
+#endif
+    }
+#endif
+
+#if PF_SIMD_NEON
+    static void stepNEON(float* x, float* y, float* v, uint32_t* f, size_t n, const Tick& t) {
+        const float32x4_t gravity = vdupq_n_f32(t.gravityStep);
+        const float32x4_t jumpVel = vdupq_n_f32(Physics::JUMP_VEL);
+        const float32x4_t velScale = vdupq_n_f32(t.velScale);
+        const float32x4_t xStep = vdupq_n_f32(t.xStep);
+        const float32x4_t groundY = vdupq_n_f32(GROUND_Y);
+        const float32x4_t maxVel = vdupq_n_f32(MAX_VEL);
+        const float32x4_t minVel = vdupq_n_f32(-MAX_VEL);
+        const uint32x4_t groundBit = vdupq_n_u32(StateFlags::GROUND);
+        const uint32x4_t clickBit = vdupq_n_u32(StateFlags::CLICK);
+        const uint32x4_t heldBit = vdupq_n_u32(StateFlags::HELD);
+        const uint32x4_t jumpBits = vdupq_n_u32(StateFlags::GROUND | StateFlags::CLICK);
+        
+        size_t i = 0;
+        for (; i + 4 <= n; i += 4) {
+            float32x4_t vx = vld1q_f32(x + i);
+            float32x4_t vy = vld1q_f32(y + i);
+            float32x4_t vv = vld1q_f32(v + i);
+            uint32x4_t fl = vld1q_u32(f + i);
+            
+            vv = vsubq_f32(vv, gravity);
+            
+            uint32x4_t jump = vceqq_u32(vandq_u32(fl, jumpBits), jumpBits);
+            vv = vbslq_f32(jump, jumpVel, vv);
+            fl = vbicq_u32(fl, vandq_u32(jump, groundBit));
+            
+            vy = vaddq_f32(vy, vmulq_f32(vv, velScale));
+            vx = vaddq_f32(vx, xStep);
+            
+            vv = vminq_f32(vmaxq_f32(vv, minVel), maxVel);
+            
+            uint32x4_t hit = vcleq_f32(vy, groundY);
+            vy = vbslq_f32(hit, groundY, vy);
+            vv = vreinterpretq_f32_u32(vbicq_u32(vreinterpretq_u32_f32(vv), hit));
+            fl = vorrq_u32(fl, vandq_u32(hit, groundBit));
+            
+            fl = vorrq_u32(vbicq_u32(fl, heldBit), vshlq_n_u32(vandq_u32(fl, clickBit), 1));
+            
+            vst1q_f32(x + i, vx);
+            vst1q_f32(y + i, vy);
+            vst1q_f32(v + i, vv);
+            vst1q_u32(f + i, fl);
+        }
+        stepScalar<0>(x + i, y + i, v + i, f + i, n - i, t);
+    }
+#endif
+    
+    static Kernel cubeKernel() {
+        static const Kernel k = []() -> Kernel {
+#if PF_SIMD_X86
+            if (cpuHasAVX2()) return stepAVX2;
+#endif
+#if PF_SIMD_NEON
+            return stepNEON;
+#endif
+            return stepScalar<0>;
+        }();
+        return k;
+    }
+    
+    template <uint32_t... V>
+    static constexpr std::array<Kernel, sizeof...(V)> scalarKernels(std::integer_sequence<uint32_t, V...>) {
+        return {stepScalar<V>...};
+    }
+    
+    // One kernel per variant; variant 0 is the plain cube
+    static const std::array<Kernel, StateFlags::VARIANTS>& kernels() {
+        static const auto table = [] {
+            auto k = scalarKernels(std::make_integer_sequence<uint32_t, StateFlags::VARIANTS>());
+            k[0] = cubeKernel();
+            return k;
+        }();
+        return table;
+    }
+    
+    // Plain scalar loops, without the SIMD cube
+    static constexpr auto SCALAR = scalarKernels(std::make_integer_sequence<uint32_t, StateFlags::VARIANTS>());
+    
+    Kernel kernelFor(uint32_t variant) {
+        return SCALAR[variant];
+    }
+    
+    void step(float* x, float* y, float* v, uint32_t* f, size_t n, const Tick& t) {
+        auto& table = kernels();
+        size_t i = 0;
+        while (i < n) {
+            uint32_t variant = StateFlags::variantOf(f[i]);
+            size_t j = i + 1;
+            while (j < n && StateFlags::variantOf(f[j]) == variant) j++;
+            table[variant](x + i, y + i, v + i, f + i, j - i, t);
+            i = j;
+        }
+    }
+    
+    const char* kernelName() {
+#if PF_SIMD_X86
+        if (cubeKernel() == stepAVX2) return "avx2";
+#endif
+#if PF_SIMD_NEON
+        if (cubeKernel() == stepNEON) return "neon";
+#endif
+        return "scalar";
+    }
+}
@@ -0,0 +1,292 @@
+#pragma once
+
+#include "BeamSoA.hpp"
+#include "Physics.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+// ============================================================================
+// BATCH PHYSICS
+// ============================================================================
+
+// Gravity / input / move / clamp / bounds step for many states at once.
+// Every kernel performs the same operations in the same order as stepOne,
+// so vector and scalar paths produce the same states.
+namespace BatchPhysics {
+    constexpr float GROUND_Y = 105;
+    constexpr float CEILING_Y = GROUND_Y + 16 * Physics::BLOCK;
+    constexpr float MAX_VEL = 20;
+    
+    // Step sizes for one tick rate. Velocities are in units per 1/60 s,
+    // so a tick moves by velocity * 60 / rate.
+    struct Tick {
+        int rate;
+        float dt;
+        float velScale;
+        float gravityStep;
+        float xStep;
+        
+        static constexpr Tick at(int rate) {
+            float dt = 1.0f / static_cast<float>(rate);
+            return {rate, dt, dt * 60, Physics::GRAVITY * (dt * 60), Physics::XVEL * (dt * 60)};
+        }
+        
+        // The same tick under a speed portal multiplier
+        constexpr Tick atSpeed(float speed) const {
+            Tick t = *this;
+            t.xStep = xStep * speed;
+            return t;
+        }
+    };
+    
+    constexpr int MIN_TICK_RATE = 30;
+    constexpr int MAX_TICK_RATE = 960;
+    constexpr Tick DEFAULT_TICK = Tick::at(Physics::TICK_RATE);
+    
+    using Kernel = void (*)(float* x, float* y, float* velY, uint32_t* flags, size_t n, const Tick& t);
+    
+    // ------------------------------------------------------------------------
+    // Gamemodes
+    // ------------------------------------------------------------------------
+    
+    // What each mode does with gravity and input before the shared move and
+    // bounds step. `up` is the direction jumps go, -1 with flipped gravity.
+    // A press is a click that wasn't held on the step before.
+    template <Gamemode M>
+    struct Mode;
+    
+    template <>
+    struct Mode<Gamemode::Cube> {
+        static constexpr float MAX_VEL = BatchPhysics::MAX_VEL;
+        static constexpr float MINI_JUMP = 0.8f;
+        static constexpr bool FLIPS = false;
+        
+        template <bool Flipped, bool Mini>
+        static void accelerate(float& v, uint32_t& f, bool grounded, const Tick& t) {
+            constexpr float up = Flipped ? -1.0f : 1.0f;
+            v -= up * t.gravityStep;
+            if (grounded && (f & StateFlags::CLICK)) {
+                v = up * (Mini ? Physics::JUMP_VEL * MINI_JUMP : Physics::JUMP_VEL);
+                f &= ~StateFlags::GROUND;
+            }
+        }
+    };
+    
+    // Holding thrusts up, releasing falls, both at a fraction of gravity
+    template <>
+    struct Mode<Gamemode::Ship> {
+        static constexpr float MAX_VEL = 8;
+        static constexpr float LIFT = 0.5f;
+        static constexpr float FALL = 0.4f;
+        static constexpr bool FLIPS = false;
+        
+        template <bool Flipped, bool Mini>
+        static void accelerate(float& v, uint32_t& f, bool, const Tick& t) {
+            constexpr float up = Flipped ? -1.0f : 1.0f;
+            float pull = (f & StateFlags::CLICK) ? LIFT : -FALL;
+            v += up * pull * t.gravityStep;
+        }
+    };
+    
+    // A press on the ground flips gravity
+    template <>
+    struct Mode<Gamemode::Ball> {
+        static constexpr float MAX_VEL = 15;
+        static constexpr float GRAVITY = 0.6f;
+        static constexpr bool FLIPS = true;
+        
+        template <bool Flipped, bool Mini>
+        static void accelerate(float& v, uint32_t& f, bool grounded, const Tick& t) {
+            bool press = (f & StateFlags::CLICK) && !(f & StateFlags::HELD);
+            if (grounded && press) {
+                f ^= StateFlags::FLIPPED;
+                v = 0;
+            }
+            float up = (f & StateFlags::FLIPPED) ? -1.0f : 1.0f;
+            v -= up * GRAVITY * t.gravityStep;
+        }
+    };
+    
+    // Every press is a small jump, in the air too
+    template <>
+    struct Mode<Gamemode::Ufo> {
+        static constexpr float MAX_VEL = 10;
+        static constexpr float GRAVITY = 0.5f;
+        static constexpr float BOOST = 7;
+        static constexpr float MINI_BOOST = 0.8f;
+        static constexpr bool FLIPS = false;
+        
+        template <bool Flipped, bool Mini>
+        static void accelerate(float& v, uint32_t& f, bool, const Tick& t) {
+            constexpr float up = Flipped ? -1.0f : 1.0f;
+            bool press = (f & StateFlags::CLICK) && !(f & StateFlags::HELD);
+            v = press ? up * (Mini ? BOOST * MINI_BOOST : BOOST) : v - up * GRAVITY * t.gravityStep;
+        }
+    };
+    
+    // Straight diagonals: up while held, down otherwise, at the horizontal
+    // speed (twice it when mini)
+    template <>
+    struct Mode<Gamemode::Wave> {
+        static constexpr float MAX_VEL = BatchPhysics::MAX_VEL;
+        static constexpr float SLOPE = Physics::XVEL;
+        static constexpr bool FLIPS = false;
+        
+        template <bool Flipped, bool Mini>
+        static void accelerate(float& v, uint32_t& f, bool, const Tick&) {
+            constexpr float up = Flipped ? -1.0f : 1.0f;
+            constexpr float slope = Mini ? SLOPE * 2 : SLOPE;
+            v = (f & StateFlags::CLICK) ? up * slope : -up * slope;
+        }
+    };
+    
+    // Jumps from the ground, and holding through the rise floats higher
+    template <>
+    struct Mode<Gamemode::Robot> {
+        static constexpr float MAX_VEL = BatchPhysics::MAX_VEL;
+        static constexpr float JUMP = 0.7f;
+        static constexpr float HOLD_GRAVITY = 0.4f;
+        static constexpr float MINI_JUMP = 0.8f;
+        static constexpr bool FLIPS = false;
+        
+        template <bool Flipped, bool Mini>
+        static void accelerate(float& v, uint32_t& f, bool grounded, const Tick& t) {
+            constexpr float up = Flipped ? -1.0f : 1.0f;
+            bool click = (f & StateFlags::CLICK) != 0;
+            float g = click && v * up > 0 ? HOLD_GRAVITY : 1.0f;
+            v -= up * g * t.gravityStep;
+            if (grounded && click) {
+                v = up * Physics::JUMP_VEL * (Mini ? JUMP * MINI_JUMP : JUMP);
+            }
+        }
+    };
+    
+    // A press on the ground flips gravity and snaps to the other side at
+    // full speed
+    template <>
+    struct Mode<Gamemode::Spider> {
+        static constexpr float MAX_VEL = BatchPhysics::MAX_VEL;
+        static constexpr bool FLIPS = true;
+        
+        template <bool Flipped, bool Mini>
+        static void accelerate(float& v, uint32_t& f, bool grounded, const Tick& t) {
+            constexpr float up = Flipped ? -1.0f : 1.0f;
+            bool press = (f & StateFlags::CLICK) && !(f & StateFlags::HELD);
+            if (grounded && press) {
+                f ^= StateFlags::FLIPPED;
+                v = up * MAX_VEL;
+            } else {
+                v -= up * t.gravityStep;
+            }
+        }
+    };
+    
+    // Every press flips gravity, in the air too
+    template <>
+    struct Mode<Gamemode::Swing> {
+        static constexpr float MAX_VEL = 10;
+        static constexpr float GRAVITY = 0.6f;
+        static constexpr bool FLIPS = true;
+        
+        template <bool Flipped, bool Mini>
+        static void accelerate(float& v, uint32_t& f, bool, const Tick& t) {
+            bool press = (f & StateFlags::CLICK) && !(f & StateFlags::HELD);
+            if (press) f ^= StateFlags::FLIPPED;
+            float up = (f & StateFlags::FLIPPED) ? -1.0f : 1.0f;
+            v -= up * GRAVITY * t.gravityStep;
+        }
+    };
+    
+    // One step of a state known to be in mode M with the given gravity and
+    // size. The cube keeps GROUND until it jumps; every other mode is only
+    // grounded while the floor, ceiling or a block holds it up.
+    template <Gamemode M, bool Flipped, bool Mini>
+    inline void stepMode(float& x, float& y, float& v, uint32_t& f, const Tick& t) {
+        using Traits = Mode<M>;
+        bool grounded = (f & StateFlags::GROUND) != 0;
+        if constexpr (M != Gamemode::Cube) f &= ~StateFlags::GROUND;
+        
+        Traits::template accelerate<Flipped, Mini>(v, f, grounded, t);
+        
+        // Move
+        y += v * t.velScale;
+        x += t.xStep;
+        
+        // Clamp velocity
+        v = std::min(std::max(v, -Traits::MAX_VEL), Traits::MAX_VEL);
+        
+        // Floor and ceiling; only the side gravity pulls towards grounds.
+        // A cube jumping upwards never gets near the ceiling.
+        bool flipped = Traits::FLIPS ? (f & StateFlags::FLIPPED) != 0 : Flipped;
+        if (y <= GROUND_Y) {
+            y = GROUND_Y;
+            v = 0;
+            if (!flipped) f |= StateFlags::GROUND;
+        }
+        if constexpr (M != Gamemode::Cube || Flipped) {
+            if (y >= CEILING_Y) {
+                y = CEILING_Y;
+                v = 0;
+                if (flipped) f |= StateFlags::GROUND;
+            }
+        }
+        
+        // Remember the input for press detection
+        f = (f & ~StateFlags::HELD) | ((f & StateFlags::CLICK) << 1);
+    }
+    
+    // Specialization for variant V of the state flags (see StateFlags)
+    template <uint32_t V>
+    inline void stepVariant(float& x, float& y, float& v, uint32_t& f, const Tick& t) {
+        stepMode<static_cast<Gamemode>(V >> 2), (V & 1) != 0, (V & 2) != 0>(x, y, v, f, t);
+    }
+    
+    template <uint32_t V>
+    inline void stepScalar(float* x, float* y, float* v, uint32_t* f, size_t n, const Tick& t) {
+        for (size_t i = 0; i < n; i++) stepVariant<V>(x[i], y[i], v[i], f[i], t);
+    }
+    
+    // Kernel for one variant, for stepping states of any mode one at a time
+    Kernel kernelFor(uint32_t variant);
+    
+    // Single state in any mode; the plain cube is stepped inline
+    inline void stepOne(float& x, float& y, float& v, uint32_t& f, const Tick& t = DEFAULT_TICK) {
+        uint32_t variant = StateFlags::variantOf(f);
+        if (variant == 0) {
+            stepVariant<0>(x, y, v, f, t);
+        } else {
+            // Through copies, so the caller's values never have their
+            // address taken and stay in registers on the cube path
+            float lx = x, ly = y, lv = v;
+            uint32_t lf = f;
+            kernelFor(variant)(&lx, &ly, &lv, &lf, 1, t);
+            x = lx;
+            y = ly;
+            v = lv;
+            f = lf;
+        }
+    }
+    
+    // True if the input of the next step can change anything: modes that
+    // only act from the ground ignore it in the air
+    inline bool decides(Gamemode mode, bool grounded) {
+        constexpr uint32_t groundOnly = 1u << static_cast<int>(Gamemode::Cube)
+                                      | 1u << static_cast<int>(Gamemode::Ball)
+                                      | 1u << static_cast<int>(Gamemode::Spider);
+        return grounded || !((groundOnly >> static_cast<int>(mode)) & 1);
+    }
+    
+    inline bool decides(uint32_t f) {
+        return decides(StateFlags::modeOf(f), (f & StateFlags::GROUND) != 0);
+    }
+    
+    // Steps n states of any mix of modes. Each run of states sharing a
+    // variant goes through that variant's kernel, so a beam grouped by mode
+    // runs branch-free loops; the plain cube gets the best SIMD kernel.
+    void step(float* x, float* y, float* velY, uint32_t* flags, size_t n, const Tick& t);
+    
+    // Kernel used for the plain cube, chosen once on first use
+    const char* kernelName();
+}
@@ -0,0 +1,129 @@
+#pragma once
+
+#include "Physics.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// ============================================================================
+// BEAM STORAGE (SoA)
+// ============================================================================
+
+namespace StateFlags {
+    constexpr uint32_t GROUND = 1u << 0;
+    constexpr uint32_t DEAD = 1u << 1;
+    constexpr uint32_t WON = 1u << 2;
+    constexpr uint32_t CLICK = 1u << 3;   // input applied on the next step
+    constexpr uint32_t HELD = 1u << 4;    // input of the previous step
+    constexpr uint32_t FLIPPED = 1u << 5;
+    constexpr uint32_t MINI = 1u << 6;
+    constexpr int MODE_SHIFT = 7;
+    constexpr uint32_t MODE_MASK = 7u << MODE_SHIFT;
+    
+    // Gravity, size and mode together pick the step specialization
+    constexpr int VARIANT_SHIFT = 5;
+    constexpr uint32_t VARIANT_MASK = 31u << VARIANT_SHIFT;
+    constexpr int VARIANTS = 32;
+    
+    constexpr Gamemode modeOf(uint32_t f) {
+        return static_cast<Gamemode>((f & MODE_MASK) >> MODE_SHIFT);
+    }
+    
+    constexpr uint32_t variantOf(uint32_t f) {
+        return (f & VARIANT_MASK) >> VARIANT_SHIFT;
+    }
+}
+
+// Beam stored as parallel arrays so the physics step can run over
+// contiguous lanes. Flags use 32-bit lanes to line up with the floats.
+// `score` caches the heuristic rank computed when the state was generated.
+struct BeamSoA {
+    static constexpr size_t BYTES_PER_STATE = sizeof(float) * 4 + sizeof(uint32_t) * 2;
+    
+    std::vector<float> x, y, velY;
+    std::vector<uint32_t> flags;
+    std::vector<uint32_t> node;
+    std::vector<float> score;
+    
+    size_t size() const { return x.size(); }
+    bool empty() const { return x.empty(); }
+    bool dead(size_t i) const { return (flags[i] & StateFlags::DEAD) != 0; }
+    
+    static uint32_t packFlags(const SimState& s) {
+        return (s.onGround ? StateFlags::GROUND : 0)
+             | (s.dead ? StateFlags::DEAD : 0)
+             | (s.won ? StateFlags::WON : 0)
+             | (s.held ? StateFlags::HELD : 0)
+             | (s.flipped ? StateFlags::FLIPPED : 0)
+             | (s.mini ? StateFlags::MINI : 0)
+             | static_cast<uint32_t>(s.mode) << StateFlags::MODE_SHIFT;
+    }
+    
+    static void unpackFlags(uint32_t f, SimState& s) {
+        s.onGround = (f & StateFlags::GROUND) != 0;
+        s.dead = (f & StateFlags::DEAD) != 0;
+        s.won = (f & StateFlags::WON) != 0;
+        s.held = (f & StateFlags::HELD) != 0;
+        s.flipped = (f & StateFlags::FLIPPED) != 0;
+        s.mini = (f & StateFlags::MINI) != 0;
+        s.mode = StateFlags::modeOf(f);
+    }
+    
+    void clear() {
+        x.clear(); y.clear(); velY.clear(); flags.clear(); node.clear(); score.clear();
+    }
+    
+    void reserve(size_t n) {
+        x.reserve(n); y.reserve(n); velY.reserve(n); flags.reserve(n); node.reserve(n); score.reserve(n);
+    }
+    
+    size_t capacity() const { return x.capacity(); }
+    
+    void resize(size_t n) {
+        x.resize(n); y.resize(n); velY.resize(n); flags.resize(n); node.resize(n); score.resize(n);
+    }
+    
+    void push(const SimState& s, uint32_t n) {
+        x.push_back(s.x);
+        y.push_back(s.y);
+        velY.push_back(s.velY);
+        flags.push_back(packFlags(s));
+        node.push_back(n);
+        score.push_back(s.x);
+    }
+    
+    void pushFrom(const BeamSoA& src, size_t i, uint32_t n) {
+        x.push_back(src.x[i]);
+        y.push_back(src.y[i]);
+        velY.push_back(src.velY[i]);
+        flags.push_back(src.flags[i] & ~StateFlags::CLICK);
+        node.push_back(n);
+        score.push_back(src.score[i]);
+    }
+    
+    void copyFrom(size_t dst, const BeamSoA& src, size_t i) {
+        x[dst] = src.x[i];
+        y[dst] = src.y[i];
+        velY[dst] = src.velY[i];
+        flags[dst] = src.flags[i];
+        node[dst] = src.node[i];
+        score[dst] = src.score[i];
+    }
+    
+    SimState get(size_t i) const {
+        SimState s;
+        s.x = x[i];
+        s.y = y[i];
+        s.velY = velY[i];
+        unpackFlags(flags[i], s);
+        return s;
+    }
+    
+    void set(size_t i, const SimState& s) {
+        x[i] = s.x;
+        y[i] = s.y;
+        velY[i] = s.velY;
+        flags[i] = packFlags(s) | (flags[i] & StateFlags::CLICK);
+    }
+};
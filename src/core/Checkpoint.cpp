@@ -0,0 +1,208 @@
+#include "Checkpoint.hpp"
+
+#include "Log.hpp"
+#include "MappedFile.hpp"
+
+#include <cstring>
+#include <fstream>
+#include <system_error>
+
+static constexpr char CHECKPOINT_MAGIC[8] = {'G', 'D', 'P', 'F', 'C', 'K', 'P', 0};
+// Bumped with the simulation too, since a beam from an older one can't resume
+static constexpr uint32_t CHECKPOINT_VERSION = 3;
+
+struct CheckpointHeader {
+    char magic[8];
+    uint32_t version;
+    int32_t frame;
+    uint64_t levelHash;
+    float bestX;
+    int32_t width;
+    uint32_t nodeCount;
+    uint32_t beamSize;
+    int32_t tickRate;
+    uint32_t reserved;
+};
+static_assert(sizeof(CheckpointHeader) == 48, "checkpoint header layout changed");
+
+template <class T>
+static void writeArray(std::ofstream& out, const std::vector<T>& v) {
+    out.write(reinterpret_cast<const char*>(v.data()), static_cast<std::streamsize>(v.size() * sizeof(T)));
+}
+
+template <class T>
+static bool readArray(ByteReader& in, std::vector<T>& v, size_t count) {
+    if (count > in.remaining() / sizeof(T)) return false;
+    v.resize(count);
+    return in.read(v.data(), count * sizeof(T));
+}
+
+bool saveCheckpoint(const std::filesystem::path& path, const Checkpoint& cp) {
+    std::error_code ec;
+    std::filesystem::create_directories(path.parent_path(), ec);
+    
+    // The previous checkpoint stays valid until the new one is complete
+    auto tmp = path;
+    tmp += ".tmp";
+    {
+        std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            LOGE("Can't write checkpoint {}", tmp.string());
+            return false;
+        }
+        
+        CheckpointHeader h{};
+        std::memcpy(h.magic, CHECKPOINT_MAGIC, sizeof(h.magic));
+        h.version = CHECKPOINT_VERSION;
+        h.frame = cp.frame;
+        h.levelHash = cp.levelHash;
+        h.bestX = cp.bestX;
+        h.width = cp.width;
+        h.nodeCount = static_cast<uint32_t>(cp.nodes.size());
+        h.beamSize = static_cast<uint32_t>(cp.beam.size());
+        h.tickRate = cp.tickRate;
+        out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+        
+        // Nodes are stored as a parent array followed by one byte per input
+        std::vector<uint32_t> parents(cp.nodes.size());
+        std::vector<uint8_t> inputs(cp.nodes.size());
+        for (size_t i = 0; i < cp.nodes.size(); i++) {
+            parents[i] = cp.nodes[i].parent;
+            inputs[i] = cp.nodes[i].input;
+        }
+        writeArray(out, parents);
+        writeArray(out, inputs);
+        
+        writeArray(out, cp.beam.x);
+        writeArray(out, cp.beam.y);
+        writeArray(out, cp.beam.velY);
+        writeArray(out, cp.beam.flags);
+        writeArray(out, cp.beam.node);
+        
+        if (!out) {
+            LOGE("Failed writing checkpoint {}", tmp.string());
+            return false;
+        }
+    }
+    
+    std::filesystem::rename(tmp, path, ec);
+    if (ec) {
+        LOGE("Can't move checkpoint into place: {}", ec.message());
+        std::filesystem::remove(tmp, ec);
+        return false;
+    }
+    return true;
+}
+
+bool loadCheckpoint(const std::filesystem::path& path, Checkpoint& cp) {
+    MappedFile file;
+    if (!file.open(path)) return false;
+    
+    ByteReader in(file.data(), file.size());
+    CheckpointHeader h;
+    if (!in.read(h) || std::memcmp(h.magic, CHECKPOINT_MAGIC, sizeof(h.magic)) != 0 ||
+        h.version != CHECKPOINT_VERSION) {
+        LOGE("Checkpoint {} has an unknown format", path.string());
+        return false;
+    }
+    
+    std::vector<uint32_t> parents;
+    std::vector<uint8_t> inputs;
+    bool ok = readArray(in, parents, h.nodeCount)
+           && readArray(in, inputs, h.nodeCount)
+           && readArray(in, cp.beam.x, h.beamSize)
+           && readArray(in, cp.beam.y, h.beamSize)
+           && readArray(in, cp.beam.velY, h.beamSize)
+           && readArray(in, cp.beam.flags, h.beamSize)
+           && readArray(in, cp.beam.node, h.beamSize);
+    if (!ok) {
+        LOGE("Checkpoint {} is truncated", path.string());
+        return false;
+    }
+    
+    // Reject anything that would index outside the tree
+    cp.nodes.resize(h.nodeCount);
+    for (size_t i = 0; i < cp.nodes.size(); i++) {
+        if (parents[i] != InputTree::ROOT && parents[i] >= i) {
+            LOGE("Checkpoint {} has a corrupt input tree", path.string());
+            return false;
+        }
+        cp.nodes[i] = {parents[i], inputs[i] != 0, 1};
+    }
+    for (uint32_t n : cp.beam.node) {
+        if (n != InputTree::ROOT && n >= h.nodeCount) {
+            LOGE("Checkpoint {} has a corrupt beam", path.string());
+            return false;
+        }
+    }
+    
+    // Scores only rank children, so a resumed beam doesn't need them
+    cp.beam.score.assign(h.beamSize, 0.0f);
+    
+    cp.levelHash = h.levelHash;
+    cp.tickRate = h.tickRate;
+    cp.frame = h.frame;
+    cp.bestX = h.bestX;
+    cp.width = h.width;
+    return true;
+}
+
+// ============================================================================
+// CHECKPOINT WRITER
+// ============================================================================
+
+CheckpointWriter::~CheckpointWriter() {
+    {
+        std::lock_guard<std::mutex> lock(m_mtx);
+        m_quit = true;
+    }
+    m_cv.notify_all();
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+}
+
+void CheckpointWriter::submit(const std::filesystem::path& path, Checkpoint& cp) {
+    {
+        std::lock_guard<std::mutex> lock(m_mtx);
+        if (!m_thread.joinable()) {
+            m_thread = std::thread([this]() { loop(); });
+        }
+        m_path = path;
+        std::swap(m_pending, cp);
+        m_hasPending = true;
+    }
+    m_cv.notify_all();
+}
+
+void CheckpointWriter::flush() {
+    std::unique_lock<std::mutex> lock(m_mtx);
+    m_cv.wait(lock, [this]() { return !m_hasPending && !m_busy; });
+}
+
+void CheckpointWriter::loop() {
+    Checkpoint writing;
+    std::unique_lock<std::mutex> lock(m_mtx);
+    
+    while (true) {
+        m_cv.wait(lock, [this]() { return m_hasPending || m_quit; });
+        
+        // Pending work is still written on shutdown
+        if (!m_hasPending) break;
+        
+        std::swap(writing, m_pending);
+        auto path = m_path;
+        m_hasPending = false;
+        m_busy = true;
+        
+        lock.unlock();
+        if (saveCheckpoint(path, writing)) {
+            LOGI("Checkpoint at frame {} saved ({} states, {} nodes)",
+                 writing.frame, writing.beam.size(), writing.nodes.size());
+        }
+        lock.lock();
+        
+        m_busy = false;
+        m_cv.notify_all();
+    }
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "BeamSoA.hpp"
+#include "InputTree.hpp"
+
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// ============================================================================
+// CHECKPOINT
+// ============================================================================
+
+// Everything needed to continue a search: the beam and only the part of
+// the input tree its states still reach. Beam node indices point into
+// `nodes`.
+struct Checkpoint {
+    uint64_t levelHash = 0;
+    int tickRate = 0;
+    int frame = 0;          // next frame to simulate
+    float bestX = 0;
+    int width = 0;
+    std::vector<InputTree::Node> nodes;
+    BeamSoA beam;
+};
+
+bool saveCheckpoint(const std::filesystem::path& path, const Checkpoint& cp);
+
+// Fails if the file is missing or corrupt
+bool loadCheckpoint(const std::filesystem::path& path, Checkpoint& cp);
+
+// ============================================================================
+// CHECKPOINT WRITER
+// ============================================================================
+
+// Writes checkpoints on its own thread. Only the newest submitted
+// checkpoint matters, so one still waiting is replaced, never queued.
+class CheckpointWriter {
+public:
+    CheckpointWriter() = default;
+    ~CheckpointWriter();
+    
+    CheckpointWriter(const CheckpointWriter&) = delete;
+    CheckpointWriter& operator=(const CheckpointWriter&) = delete;
+    
+    // Takes `cp` by swapping, so the caller gets an old buffer back to
+    // fill next time instead of allocating a new one
+    void submit(const std::filesystem::path& path, Checkpoint& cp);
+    
+    // Blocks until everything submitted so far is on disk
+    void flush();
+    
+private:
+    std::thread m_thread;
+    std::mutex m_mtx;
+    std::condition_variable m_cv;
+    std::filesystem::path m_path;
+    Checkpoint m_pending;
+    bool m_hasPending = false;
+    bool m_busy = false;
+    bool m_quit = false;
+    
+    void loop();
+};
@@ -0,0 +1,193 @@
+#include "DangerMap.hpp"
+
+#include "Log.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+// Margin that keeps every approximation on the safe side: hazard probes
+// shrink by it and transition boxes grow by it
+static constexpr float PROBE_EPS = 0.01f;
+
+void DangerMap::clear() {
+    m_slices = 0;
+    m_sliceFrames = 1;
+    m_tickRate = 0;
+    m_cells = 0;
+    m_doomedCells = 0;
+    m_doomed.clear();
+}
+
+void DangerMap::build(const Level& level, int frames, float goalX, const BatchPhysics::Tick& tick,
+                      const std::atomic<bool>* running) {
+    using namespace BatchPhysics;
+    auto start = std::chrono::steady_clock::now();
+    
+    clear();
+    
+    // Only the plain cube is modelled, so nothing is known from the first
+    // portal on
+    float portalX = level.firstPortalX();
+    goalX = std::min(goalX, portalX - 12 - PROBE_EPS);
+    
+    int sliceFrames = std::max(1, static_cast<int>(SLICE_SECONDS * tick.rate));
+    m_sliceFrames = sliceFrames;
+    m_tickRate = tick.rate;
+    m_slices = frames / sliceFrames + 1;
+    m_cells = Y_CELLS * V_CELLS;
+    m_doomed.assign((static_cast<size_t>(m_slices) * m_cells + 63) / 64, 0);
+    
+    // Where a point resting on the floor ends up if it jumps with `s`
+    // steps of the slice left. It can't land again before the slice ends.
+    int groundCell = cellOf(GROUND_Y, 0);
+    std::vector<int> jumpCell(sliceFrames + 1, -1);
+    for (int s = 1; s <= sliceFrames; s++) {
+        float x = 0, y = GROUND_Y, v = 0;
+        uint32_t f = StateFlags::GROUND | StateFlags::CLICK;
+        for (int k = 0; k < s; k++) {
+            stepOne(x, y, v, f, tick);
+            f &= ~StateFlags::CLICK;
+        }
+        jumpCell[s] = cellOf(y, v);
+    }
+    
+    // Airborne part of each cell's reach one slice later, and the first
+    // step after which some of its states may rest on the floor. Without
+    // the floor, gravity doesn't depend on x, so this is computed once.
+    // Hazards crossed mid-air are ignored, which only grows the reach.
+    std::vector<std::vector<uint16_t>> airNext(m_cells);
+    std::vector<int> touch(m_cells, -1);
+    std::vector<bool> escapes(m_cells, false);
+    for (int cell = 0; cell < m_cells; cell++) {
+        int iy = cell / V_CELLS, iv = cell % V_CELLS;
+        
+        // Padded so rounding in cellOf() can't place a state outside its box
+        float ylo = GROUND_Y + iy * Y_CELL - PROBE_EPS, yhi = ylo + Y_CELL + 2 * PROBE_EPS;
+        float vlo = -MAX_VEL + iv * V_CELL - PROBE_EPS, vhi = vlo + V_CELL + 2 * PROBE_EPS;
+        
+        if (cell == groundCell) touch[cell] = 0;
+        bool air = true;
+        for (int k = 0; k < sliceFrames && air; k++) {
+            vlo -= tick.gravityStep;
+            vhi -= tick.gravityStep;
+            ylo += vlo * tick.velScale;
+            yhi += vhi * tick.velScale;
+            vlo = std::clamp(vlo, -MAX_VEL, MAX_VEL);
+            vhi = std::clamp(vhi, -MAX_VEL, MAX_VEL);
+            if (ylo <= GROUND_Y) {
+                if (touch[cell] < 0) touch[cell] = k + 1;
+                if (yhi <= GROUND_Y) air = false;
+                ylo = GROUND_Y;
+            }
+        }
+        if (!air) continue;
+        
+        int y0 = static_cast<int>(std::floor((ylo - GROUND_Y) / Y_CELL));
+        int y1 = static_cast<int>(std::floor((yhi - GROUND_Y) / Y_CELL));
+        int v0 = static_cast<int>(std::floor((vlo + MAX_VEL) / V_CELL));
+        int v1 = static_cast<int>(std::floor((vhi + MAX_VEL) / V_CELL));
+        if (y1 >= Y_CELLS || v0 < 0 || v1 >= V_CELLS) escapes[cell] = true;
+        for (int y = y0; y <= std::min(y1, Y_CELLS - 1); y++) {
+            for (int v = std::max(v0, 0); v <= std::min(v1, V_CELLS - 1); v++) {
+                airNext[cell].push_back(static_cast<uint16_t>(y * V_CELLS + v));
+            }
+        }
+    }
+    
+    // x on every slice boundary, accumulated exactly like the kernels do
+    std::vector<float> sliceX(m_slices + 1);
+    float x = 0;
+    for (int f = 0; f <= m_slices * sliceFrames; f++) {
+        if (f % sliceFrames == 0) sliceX[f / sliceFrames] = x;
+        x += tick.xStep;
+    }
+    
+    // Sweep backwards: a cell is doomed if its states are inside a hazard
+    // right at the boundary, or if everything they can reach is doomed
+    std::vector<uint8_t> later(m_cells, 0), now(m_cells, 0);
+    std::vector<uint8_t> hit(Y_CELLS);
+    std::vector<uint8_t> groundSafe(sliceFrames + 1);
+    std::vector<uint8_t> jumpsDoomed(sliceFrames + 1);
+    
+    // Moving hazards are where they are when the player reaches px
+    auto hitsHazard = [&](const HitRect& r, float px) {
+        bool found = false;
+        level.forEachCandidateAt(r, px, [&](const LevelObject& obj) {
+            if (!obj.isHazard) return true;
+            found = true;
+            return false;
+        });
+        return found;
+    };
+    
+    for (int slice = m_slices - 1; slice >= 0; slice--) {
+        if (running && !running->load(std::memory_order_relaxed)) {
+            clear();
+            return;
+        }
+        
+        float sx = sliceX[slice];
+        if (sx + 12 >= portalX) {
+            std::fill(later.begin(), later.end(), 0);
+            continue;
+        }
+        
+        // Hazards covering the region every player box of a y row shares
+        for (int iy = 0; iy < Y_CELLS; iy++) {
+            float ylo = GROUND_Y + iy * Y_CELL;
+            hit[iy] = hitsHazard({sx - 12 + PROBE_EPS, ylo + Y_CELL - 12 + PROBE_EPS,
+                                  24 - 2 * PROBE_EPS, 24 - Y_CELL - 2 * PROBE_EPS}, sx);
+        }
+        
+        // No inference across the goal, past the last slice, or where a
+        // solid could catch the player
+        bool infer = slice + 1 < m_slices && sliceX[slice + 1] < goalX;
+        if (infer) {
+            HitRect sweep = {sx - 12, GROUND_Y - 12, sliceX[slice + 1] - sx + 24, Y_CELLS * Y_CELL + 24};
+            level.forEachCandidate(sweep, [&](const LevelObject& obj) {
+                if (!obj.isSolid) return true;
+                infer = false;
+                return false;
+            });
+        }
+        
+        if (infer) {
+            // Resting on the floor k steps into the slice, exactly as collide() checks it
+            float gx = sx;
+            for (int k = 0; k <= sliceFrames; k++) {
+                groundSafe[k] = !hitsHazard({gx - 12, GROUND_Y - 12, 24, 24}, gx);
+                gx += tick.xStep;
+            }
+            
+            // jumpsDoomed[t]: every jump that starts from the floor at step
+            // t or later, and staying on the floor to the end, is doomed
+            jumpsDoomed[sliceFrames] = !groundSafe[sliceFrames] || later[groundCell];
+            for (int t = sliceFrames - 1; t >= 0; t--) {
+                int c = jumpCell[sliceFrames - t];
+                bool doomed = !groundSafe[t] || (c >= 0 && later[c]);
+                jumpsDoomed[t] = jumpsDoomed[t + 1] && doomed;
+            }
+        }
+        
+        for (int cell = 0; cell < m_cells; cell++) {
+            bool doomed = hit[cell / V_CELLS] != 0;
+            if (!doomed && infer && !escapes[cell]) {
+                auto& air = airNext[cell];
+                doomed = std::all_of(air.begin(), air.end(), [&](uint16_t c) { return later[c] != 0; })
+                      && (touch[cell] < 0 || jumpsDoomed[touch[cell]]);
+            }
+            now[cell] = doomed;
+            if (doomed) {
+                size_t bit = static_cast<size_t>(slice) * m_cells + cell;
+                m_doomed[bit / 64] |= uint64_t(1) << (bit % 64);
+                m_doomedCells++;
+            }
+        }
+        std::swap(now, later);
+    }
+    
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    LOGI("Danger map: {} slices, {} of {} cells doomed, built in {:.0f} ms",
+         m_slices, m_doomedCells, static_cast<size_t>(m_slices) * m_cells, ms);
+}
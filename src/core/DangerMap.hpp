@@ -0,0 +1,80 @@
+#pragma once
+
+#include "BatchPhysics.hpp"
+#include "Level.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// ============================================================================
+// DANGER MAP
+// ============================================================================
+
+// Backward reachability over (frame slice, quantized y, velY bucket) cells.
+// A cell is doomed when every state in it dies no matter what is pressed
+// afterwards, so the search can drop such states before they take beam
+// slots. Transitions between slices over-approximate what the physics can
+// reach, so a cell is only ever marked doomed when that is certain.
+class DangerMap {
+public:
+    // Slices are shorter than a jump's airtime, so a jump started inside
+    // a slice never lands inside the same slice
+    static constexpr float SLICE_SECONDS = 0.25f;
+    static constexpr float Y_CELL = 4;
+    static constexpr int Y_CELLS = 120;
+    static constexpr float V_CELL = 1;
+    static constexpr int V_CELLS = static_cast<int>(2 * BatchPhysics::MAX_VEL / V_CELL) + 1;
+    
+    // `frames` is the longest search the map needs to cover, in ticks of
+    // `tick`, and `goalX` the x at which the level counts as completed.
+    // The map stops short of the level's first portal. Once `running` is
+    // cleared the build gives up and leaves the map empty.
+    void build(const Level& level, int frames, float goalX, const BatchPhysics::Tick& tick,
+               const std::atomic<bool>* running = nullptr);
+    void clear();
+    
+    bool empty() const {
+        return m_slices == 0;
+    }
+    
+    size_t doomedCells() const {
+        return m_doomedCells;
+    }
+    
+    int tickRate() const {
+        return m_tickRate;
+    }
+    
+    // True if a state at `frame` is certain to die. Only frames on a slice
+    // boundary are known; every other frame returns false. The sweep takes
+    // anything above the floor to be airborne, but a cube keeps GROUND
+    // after walking off a block and can still jump, so `grounded` states
+    // above the floor are never doomed.
+    bool doomed(int frame, float y, float velY, bool grounded) const {
+        if (m_slices == 0 || frame % m_sliceFrames != 0) return false;
+        if (grounded && y > BatchPhysics::GROUND_Y) return false;
+        int slice = frame / m_sliceFrames;
+        int cell = cellOf(y, velY);
+        if (slice >= m_slices || cell < 0) return false;
+        
+        size_t bit = static_cast<size_t>(slice) * m_cells + cell;
+        return (m_doomed[bit / 64] >> (bit % 64)) & 1;
+    }
+    
+private:
+    int m_slices = 0;
+    int m_sliceFrames = 1;
+    int m_tickRate = 0;
+    int m_cells = 0;
+    size_t m_doomedCells = 0;
+    std::vector<uint64_t> m_doomed;
+    
+    static int cellOf(float y, float velY) {
+        float fy = (y - BatchPhysics::GROUND_Y) / Y_CELL;
+        float fv = (velY + BatchPhysics::MAX_VEL) / V_CELL;
+        if (fy < 0 || fv < 0 || fy >= Y_CELLS || fv >= V_CELLS) return -1;
+        return static_cast<int>(fy) * V_CELLS + static_cast<int>(fv);
+    }
+};
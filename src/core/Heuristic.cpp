@@ -0,0 +1,132 @@
+#include "Heuristic.hpp"
+
+#include "BatchPhysics.hpp"
+#include "Pathfinder.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+
+// How far around the player hazards and ceilings are looked for
+static constexpr float SCAN_X = Physics::BLOCK * 2;
+static constexpr float SCAN_Y = Physics::BLOCK * 2;
+
+Heuristic heuristicFromName(const std::string& name) {
+    return name == "guided" ? Heuristic::Guided : Heuristic::Progress;
+}
+
+const char* heuristicName(Heuristic h) {
+    return h == Heuristic::Progress ? "progress" : "guided";
+}
+
+static float progressScore(const StateScorer&, float x, float, float, uint32_t) {
+    return x;
+}
+
+static float guidedScore(const StateScorer& s, float x, float y, float velY, uint32_t flags) {
+    auto& cfg = s.config();
+    float clearance = 1;
+    float hazard = s.hazardTerm(x, y, clearance);
+    float ground = (flags & StateFlags::GROUND) ? 1.0f : 0.0f;
+    float survival = s.survivalTerm(x, y, velY, flags);
+    return x + cfg.hazardWeight * hazard
+             + cfg.clearanceWeight * clearance
+             + cfg.groundWeight * ground
+             + cfg.survivalWeight * survival;
+}
+
+StateScorer::StateScorer(const Level& level, const HeuristicConfig& cfg, const BatchPhysics::Tick& tick)
+    : m_level(&level), m_cfg(cfg), m_tick(tick) {
+    m_fn = cfg.kind == Heuristic::Progress ? progressScore : guidedScore;
+    if (cfg.kind == Heuristic::Guided) m_rollouts.reset(new std::atomic<uint64_t>[ROLLOUT_SLOTS]());
+    for (auto& c : level.speedChanges) m_maxSpeed = std::max(m_maxSpeed, c.speed);
+}
+
+float StateScorer::reach() const {
+    float fastest = *std::max_element(std::begin(Physics::SPEEDS), std::end(Physics::SPEEDS));
+    float rollout = (m_cfg.lookaheadFrames + 1) * m_tick.xStep * fastest;
+    return 12 + std::max(SCAN_X, rollout) + 12;
+}
+
+// Distance to the nearest hazard ahead of or level with the player (1 =
+// nothing within SCAN_X), and in `clearance` the free room above its head
+float StateScorer::hazardTerm(float x, float y, float& clearance) const {
+    HitRect player = {x - 12, y - 12, 24, 24};
+    HitRect scan = {player.x, player.y - SCAN_Y, player.w + SCAN_X, player.h + SCAN_Y * 2};
+    
+    float nearest = SCAN_X;
+    float room = SCAN_Y;
+    m_level->forEachCandidateAt(scan, x, [&](const LevelObject& obj) {
+        HitRect r = obj.rect();
+        float dx = std::max(0.0f, r.x - (player.x + player.w));
+        float dy = std::max({0.0f, r.y - (player.y + player.h), player.y - (r.y + r.h)});
+        
+        if (obj.isHazard) {
+            nearest = std::min(nearest, std::sqrt(dx * dx + dy * dy));
+        }
+        
+        bool overhead = r.x < player.x + player.w && player.x < r.x + r.w && r.y >= player.y + player.h;
+        if (overhead) {
+            room = std::min(room, r.y - (player.y + player.h));
+        }
+        return true;
+    });
+    
+    clearance = room / SCAN_Y;
+    return nearest / SCAN_X;
+}
+
+// Fraction of the lookahead survived by the better of two rollouts, never
+// jumping and jumping whenever possible. Only hazards kill, so states with
+// no hazard in reach for the whole lookahead skip the rollouts.
+// States in the same rollout cell share one result.
+float StateScorer::survivalTerm(float x, float y, float velY, uint32_t flags) const {
+    int frames = m_cfg.lookaheadFrames;
+    if (frames <= 0) return 1;
+    
+    // The reach box only bounds a plain cube at up to the fastest speed
+    if (StateFlags::variantOf(flags) == 0) {
+        float up = std::max(velY, Physics::JUMP_VEL);
+        float rise = up * up / (2 * m_tick.gravityStep) * m_tick.velScale;
+        float bottom = std::min(y, BatchPhysics::GROUND_Y) - 12;
+        float ahead = frames * m_tick.xStep * m_maxSpeed;
+        HitRect reach = {x - 12, bottom, 24 + ahead, (y + 12 + rise) - bottom};
+        if (!m_level->occupancy.mayOverlap(reach, true)) return 1;
+    }
+    
+    uint64_t key = static_cast<uint32_t>(std::lround(x / ROLLOUT_X));
+    key = key * 0x9e3779b97f4a7c15ull ^ static_cast<uint32_t>(std::lround(y / ROLLOUT_Y));
+    key = key * 0x9e3779b97f4a7c15ull ^ static_cast<uint32_t>(std::lround(velY / ROLLOUT_VEL));
+    key = key * 0x9e3779b97f4a7c15ull ^ StateFlags::variantOf(flags);
+    key ^= key >> 29;
+    uint64_t tag = (key | 1ull << 63) & ~0xffffull;
+    
+    auto& slot = m_rollouts[(key >> 16) & (ROLLOUT_SLOTS - 1)];
+    uint64_t hit = slot.load(std::memory_order_relaxed);
+    if ((hit & ~0xffffull) == tag) return static_cast<float>(hit & 0xffff) / frames;
+    
+    int best = rollout(x, y, velY, flags);
+    slot.store(tag | static_cast<uint64_t>(best), std::memory_order_relaxed);
+    return static_cast<float>(best) / frames;
+}
+
+// Ticks survived by the better of the two policies
+int StateScorer::rollout(float x, float y, float velY, uint32_t flags) const {
+    int frames = m_cfg.lookaheadFrames;
+    int best = 0;
+    for (int policy = 0; policy < 2 && best < frames; policy++) {
+        SimState s;
+        s.x = x;
+        s.y = y;
+        s.velY = velY;
+        BeamSoA::unpackFlags(flags & ~StateFlags::CLICK, s);
+        
+        int f = 0;
+        for (; f < frames; f++) {
+            SimplePathfinder::simulateFrame(s, policy == 1, *m_level, m_tick);
+            if (s.dead) break;
+        }
+        best = std::max(best, f);
+    }
+    return best;
+}
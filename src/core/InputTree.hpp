@@ -0,0 +1,140 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// ============================================================================
+// INPUT TREE
+// ============================================================================
+
+// Append-only pool of {parent, input} nodes shared by every beam state.
+// A state only carries the index of its newest node; the full input
+// sequence is rebuilt once by walking parents back to the root. A node
+// normally covers one frame; a longer one holds its input for the first
+// frame and releases for the rest.
+class InputTree {
+public:
+    static constexpr uint32_t ROOT = 0xFFFFFFFFu;
+    
+    struct Node {
+        uint32_t parent;
+        bool input;
+        uint16_t frames;
+    };
+    
+    void clear() {
+        m_nodes.clear();
+    }
+    
+    void reserve(size_t n) {
+        m_nodes.reserve(n);
+    }
+    
+    size_t size() const {
+        return m_nodes.size();
+    }
+    
+    size_t capacity() const {
+        return m_nodes.capacity();
+    }
+    
+    uint32_t push(uint32_t parent, bool input, uint16_t frames = 1) {
+        m_nodes.push_back({parent, input, frames});
+        return static_cast<uint32_t>(m_nodes.size() - 1);
+    }
+    
+    std::vector<bool> rebuild(uint32_t node) const {
+        size_t len = 0;
+        for (uint32_t n = node; n != ROOT; n = m_nodes[n].parent) len += m_nodes[n].frames;
+        
+        std::vector<bool> inputs(len);
+        for (uint32_t n = node; n != ROOT; n = m_nodes[n].parent) {
+            len -= m_nodes[n].frames;
+            inputs[len] = m_nodes[n].input;
+        }
+        return inputs;
+    }
+    
+    // Deepest node shared by every path in `nodes`, which must all sit at
+    // `depth` in a tree of single-frame nodes. The walk stops at `minDepth`,
+    // a depth already known to be shared. Returns the depth of the ancestor
+    // found; `nodes` is scratch.
+    size_t commonAncestorDepth(std::vector<uint32_t>& nodes, size_t depth, size_t minDepth) const {
+        while (depth > minDepth) {
+            std::sort(nodes.begin(), nodes.end());
+            nodes.erase(std::unique(nodes.begin(), nodes.end()), nodes.end());
+            if (nodes.size() <= 1) break;
+            
+            for (auto& n : nodes) n = m_nodes[n].parent;
+            depth--;
+        }
+        return depth;
+    }
+    
+    // Copies only the nodes on some path from `leaves` to the root into
+    // `out`, keeping parents ahead of children, and rewrites `leaves` to
+    // index into `out`. `scratch` is reused between calls.
+    void extract(std::vector<uint32_t>& leaves, std::vector<Node>& out, std::vector<uint32_t>& scratch) const {
+        constexpr uint32_t UNUSED = ROOT;
+        constexpr uint32_t KEEP = ROOT - 1;
+        
+        scratch.assign(m_nodes.size(), UNUSED);
+        for (uint32_t leaf : leaves) {
+            for (uint32_t n = leaf; n != ROOT && scratch[n] == UNUSED; n = m_nodes[n].parent) {
+                scratch[n] = KEEP;
+            }
+        }
+        
+        // Parents always precede their children, so one forward pass remaps
+        out.clear();
+        for (size_t i = 0; i < m_nodes.size(); i++) {
+            if (scratch[i] == UNUSED) continue;
+            uint32_t parent = m_nodes[i].parent;
+            scratch[i] = static_cast<uint32_t>(out.size());
+            out.push_back({parent == ROOT ? ROOT : scratch[parent], m_nodes[i].input, m_nodes[i].frames});
+        }
+        for (auto& leaf : leaves) {
+            if (leaf != ROOT) leaf = scratch[leaf];
+        }
+    }
+    
+    // Same as extract(), but in place: every node no path from `leaves`
+    // uses is dropped and the capacity is kept. Depths don't change, so
+    // commonAncestorDepth() still works across a compaction.
+    void compact(std::vector<uint32_t>& leaves, std::vector<uint32_t>& scratch) {
+        constexpr uint32_t UNUSED = ROOT;
+        constexpr uint32_t KEEP = ROOT - 1;
+        
+        scratch.assign(m_nodes.size(), UNUSED);
+        for (uint32_t leaf : leaves) {
+            for (uint32_t n = leaf; n != ROOT && scratch[n] == UNUSED; n = m_nodes[n].parent) {
+                scratch[n] = KEEP;
+            }
+        }
+        
+        // New indices never exceed old ones, so nodes only move down
+        size_t kept = 0;
+        for (size_t i = 0; i < m_nodes.size(); i++) {
+            if (scratch[i] == UNUSED) continue;
+            Node n = m_nodes[i];
+            if (n.parent != ROOT) n.parent = scratch[n.parent];
+            scratch[i] = static_cast<uint32_t>(kept);
+            m_nodes[kept++] = n;
+        }
+        m_nodes.resize(kept);
+        for (auto& leaf : leaves) {
+            if (leaf != ROOT) leaf = scratch[leaf];
+        }
+    }
+    
+    // Replaces the tree with nodes produced by extract()
+    void assign(std::vector<Node>&& nodes) {
+        m_nodes = std::move(nodes);
+    }
+    
+private:
+    std::vector<Node> m_nodes;
+};
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// ============================================================================
+// KEY SET
+// ============================================================================
+
+// Open-addressing set of state keys for dedup, cleared every generation.
+// One flat table with linear probing: no per-key allocation, and clear()
+// keeps the table, so a search that has reached its width never touches
+// the heap for dedup again. Keys must not have the top bit set, which
+// stateKey() never does; the all-ones key marks empty slots.
+class KeySet {
+public:
+    // Sizes the table for `count` keys without growing
+    void reserve(size_t count) {
+        size_t want = 16;
+        while (want < count * 2) want *= 2;
+        if (want > m_slots.size()) rehash(want);
+    }
+    
+    void clear() {
+        if (m_size == 0) return;
+        std::fill(m_slots.begin(), m_slots.end(), EMPTY);
+        m_size = 0;
+    }
+    
+    // True if `key` wasn't in the set yet
+    bool insert(uint64_t key) {
+        if ((m_size + 1) * 2 > m_slots.size()) rehash(std::max<size_t>(16, m_slots.size() * 2));
+        
+        size_t mask = m_slots.size() - 1;
+        for (size_t i = mix(key) & mask;; i = (i + 1) & mask) {
+            if (m_slots[i] == key) return false;
+            if (m_slots[i] == EMPTY) {
+                m_slots[i] = key;
+                m_size++;
+                return true;
+            }
+        }
+    }
+    
+    size_t size() const {
+        return m_size;
+    }
+    
+    // Table slots, for tracking reallocations
+    size_t capacity() const {
+        return m_slots.size();
+    }
+
+private:
+    static constexpr uint64_t EMPTY = ~uint64_t(0);
+    
+    std::vector<uint64_t> m_slots;
+    size_t m_size = 0;
+    
+    // Keys are packed bit fields; spread them over the whole table
+    static uint64_t mix(uint64_t k) {
+        k ^= k >> 33;
+        k *= 0xff51afd7ed558ccdull;
+        k ^= k >> 33;
+        return k;
+    }
+    
+    void rehash(size_t slots) {
+        std::vector<uint64_t> old(slots, EMPTY);
+        old.swap(m_slots);
+        m_size = 0;
+        for (uint64_t key : old) {
+            if (key != EMPTY) insert(key);
+        }
+    }
+};
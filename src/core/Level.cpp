@@ -0,0 +1,123 @@
+#include "Level.hpp"
+
+#include "Log.hpp"
+
+#include <limits>
+
+void SpatialIndex::build(const std::vector<LevelObject>& objects) {
+    clear();
+    if (objects.empty()) return;
+    
+    float maxRight = 0;
+    for (auto& o : objects) maxRight = std::max(maxRight, o.right());
+    int cols = columnOf(maxRight) + 1;
+    
+    // Count, prefix-sum, then fill
+    colStart.assign(cols + 1, 0);
+    firstCol.resize(objects.size());
+    for (size_t i = 0; i < objects.size(); i++) {
+        int c0 = columnOf(objects[i].left());
+        int c1 = columnOf(objects[i].right());
+        firstCol[i] = c0;
+        for (int c = c0; c <= c1; c++) colStart[c + 1]++;
+    }
+    for (int c = 0; c < cols; c++) colStart[c + 1] += colStart[c];
+    
+    colItems.resize(colStart[cols]);
+    std::vector<uint32_t> fill(colStart.begin(), colStart.end() - 1);
+    for (size_t i = 0; i < objects.size(); i++) {
+        int c1 = columnOf(objects[i].right());
+        for (int c = firstCol[i]; c <= c1; c++) {
+            colItems[fill[c]++] = static_cast<uint32_t>(i);
+        }
+    }
+}
+
+void OccupancyGrid::build(const std::vector<LevelObject>& objects) {
+    clear();
+    if (objects.empty()) return;
+    
+    float maxRight = 0, maxTop = 0;
+    for (auto& o : objects) {
+        if (o.portal != Portal::None) continue;
+        maxRight = std::max(maxRight, o.right());
+        maxTop = std::max(maxTop, o.y + o.h / 2);
+    }
+    cols = cellOf(maxRight) + 1;
+    rows = cellOf(maxTop) + 1;
+    words = (rows + 63) / 64;
+    hazard.assign(static_cast<size_t>(cols) * words, 0);
+    solid.assign(static_cast<size_t>(cols) * words, 0);
+    
+    for (auto& o : objects) {
+        if (o.portal != Portal::None) continue;
+        auto& plane = o.isHazard ? hazard : solid;
+        HitRect r = o.rect();
+        int c0 = cellOf(r.x), c1 = cellOf(r.x + r.w);
+        int r0 = cellOf(r.y), r1 = cellOf(r.y + r.h);
+        for (int c = c0; c <= c1; c++) {
+            for (int row = r0; row <= r1; row++) {
+                plane[static_cast<size_t>(c) * words + row / 64] |= uint64_t(1) << (row % 64);
+            }
+        }
+    }
+}
+
+void Level::clear() {
+    objects.clear();
+    motion.clear();
+    index.clear();
+    occupancy.clear();
+    portals.clear();
+    speedChanges.clear();
+    portalReach = 0;
+    levelLength = 0;
+}
+
+void Level::finalize() {
+    // Stable, so finalizing a loaded level keeps the saved order of objects
+    // with the same left edge and the level hashes the same
+    std::stable_sort(objects.begin(), objects.end(),
+        [](auto& a, auto& b) { return a.left() < b.left(); });
+    index.build(objects);
+    occupancy.build(objects);
+    buildPortals();
+}
+
+void Level::buildPortals() {
+    portals.clear();
+    speedChanges.clear();
+    portalReach = 0;
+    
+    for (size_t i = 0; i < objects.size(); i++) {
+        auto& o = objects[i];
+        if (isSpeedPortal(o.portal)) {
+            speedChanges.push_back({o.x, portalSpeed(o.portal)});
+        } else if (o.portal != Portal::None) {
+            portals.push_back(static_cast<uint32_t>(i));
+            portalReach = std::max(portalReach, o.w);
+        }
+    }
+    std::stable_sort(speedChanges.begin(), speedChanges.end(),
+        [](auto& a, auto& b) { return a.x < b.x; });
+}
+
+float Level::firstPortalX() const {
+    float x = std::numeric_limits<float>::infinity();
+    if (!portals.empty()) x = objects[portals.front()].left();
+    if (!speedChanges.empty()) x = std::min(x, speedChanges.front().x);
+    return x;
+}
+
+void Level::logSummary() const {
+    LOGI("Total objects found: {}", objects.size());
+    LOGI("Hazards: {}", std::count_if(objects.begin(), objects.end(), [](auto& o) { return o.isHazard; }));
+    LOGI("Solids: {}", std::count_if(objects.begin(), objects.end(), [](auto& o) { return o.isSolid; }));
+    LOGI("Portals: {} ({} speed)", portals.size() + speedChanges.size(), speedChanges.size());
+    if (!motion.empty()) {
+        LOGI("Moving objects: {} ({} keys)", motion.tracks.size(), motion.keys.size());
+    }
+    LOGI("Level length: {}", levelLength);
+    LOGI("Index columns: {}, entries: {}", index.columns(), index.colItems.size());
+    LOGI("Occupancy grid: {}x{} cells", occupancy.cols, occupancy.rows);
+}
@@ -0,0 +1,313 @@
+#pragma once
+
+#include "Physics.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <vector>
+
+// ============================================================================
+// LEVEL OBJECT
+// ============================================================================
+
+// What touching a portal does. Mode portals follow Gamemode order.
+enum class Portal : uint8_t {
+    None,
+    Cube, Ship, Ball, Ufo, Wave, Robot, Spider, Swing,
+    GravityDown, GravityUp,
+    SizeNormal, SizeMini,
+    Speed0, Speed1, Speed2, Speed3, Speed4,
+};
+
+inline bool isModePortal(Portal p) {
+    return p >= Portal::Cube && p <= Portal::Swing;
+}
+
+inline bool isSpeedPortal(Portal p) {
+    return p >= Portal::Speed0 && p <= Portal::Speed4;
+}
+
+inline Gamemode portalMode(Portal p) {
+    return static_cast<Gamemode>(static_cast<int>(p) - static_cast<int>(Portal::Cube));
+}
+
+inline float portalSpeed(Portal p) {
+    return Physics::SPEEDS[static_cast<int>(p) - static_cast<int>(Portal::Speed0)];
+}
+
+constexpr uint32_t NO_TRACK = ~uint32_t(0);
+
+// For an object on a motion track, x/y/w/h are the box swept over the whole
+// track, so the index and grid built from them stay conservative; the real
+// hitbox comes from Level::forEachCandidateAt.
+struct LevelObject {
+    int id;
+    float x, y, w, h;
+    bool isHazard;
+    bool isSolid;
+    Portal portal = Portal::None;
+    uint32_t track = NO_TRACK;
+    
+    float left() const { return x - w / 2; }
+    float right() const { return x + w / 2; }
+    HitRect rect() const { return {x - w / 2, y - h / 2, w, h}; }
+};
+
+// ============================================================================
+// SPATIAL INDEX
+// ============================================================================
+
+// Objects bucketed into fixed-width X columns. Each column lists every object
+// whose horizontal extent overlaps it, in left-edge order (CSR layout), so a
+// query only touches the one or two columns under the player hitbox.
+struct SpatialIndex {
+    static constexpr float COLUMN_WIDTH = Physics::BLOCK;
+    
+    std::vector<uint32_t> colStart;   // size = columns + 1
+    std::vector<uint32_t> colItems;   // object indices per column
+    std::vector<int> firstCol;        // first column of each object
+    
+    static int columnOf(float x) {
+        return x <= 0 ? 0 : static_cast<int>(x / COLUMN_WIDTH);
+    }
+    
+    int columns() const {
+        return colStart.empty() ? 0 : static_cast<int>(colStart.size()) - 1;
+    }
+    
+    void clear() {
+        colStart.clear();
+        colItems.clear();
+        firstCol.clear();
+    }
+    
+    // Expects objects already sorted by left edge.
+    void build(const std::vector<LevelObject>& objects);
+    
+    // Calls fn(index) once for every object whose X extent overlaps
+    // [left, right]. Stops early if fn returns false.
+    template <class F>
+    void query(float left, float right, F&& fn) const {
+        int cols = columns();
+        if (cols == 0) return;
+        
+        int c0 = columnOf(left);
+        int c1 = std::min(columnOf(right), cols - 1);
+        
+        for (int c = c0; c <= c1; c++) {
+            for (uint32_t k = colStart[c]; k < colStart[c + 1]; k++) {
+                uint32_t i = colItems[k];
+                // Objects spanning several columns are reported only once
+                if (c != c0 && firstCol[i] != c) continue;
+                if (!fn(i)) return;
+            }
+        }
+    }
+};
+
+// ============================================================================
+// OCCUPANCY GRID
+// ============================================================================
+
+// Hazards and solids (not portals) rasterized into half-block cells: one
+// run of 64-bit words per X column, one bit per Y cell. Cells are marked
+// conservatively, so a clear query means no object can touch the rect and
+// the exact HitRect tests can be skipped.
+struct OccupancyGrid {
+    static constexpr float CELL = Physics::BLOCK / 2;
+    
+    int cols = 0;
+    int rows = 0;
+    int words = 0;                   // words per column
+    std::vector<uint64_t> hazard;
+    std::vector<uint64_t> solid;
+    
+    static int cellOf(float v) {
+        return v <= 0 ? 0 : static_cast<int>(v / CELL);
+    }
+    
+    void clear() {
+        cols = rows = words = 0;
+        hazard.clear();
+        solid.clear();
+    }
+    
+    void build(const std::vector<LevelObject>& objects);
+    
+    // False only if nothing in the grid can overlap r. With `hazardsOnly`,
+    // solids are ignored.
+    bool mayOverlap(const HitRect& r, bool hazardsOnly = false) const {
+        if (cols == 0) return false;
+        
+        int c0 = cellOf(r.x), c1 = std::min(cellOf(r.x + r.w), cols - 1);
+        int r0 = cellOf(r.y), r1 = std::min(cellOf(r.y + r.h), rows - 1);
+        if (c0 > c1 || r0 > r1) return false;
+        
+        for (int w = r0 / 64; w <= r1 / 64; w++) {
+            int lo = std::max(r0, w * 64) - w * 64;
+            int hi = std::min(r1, w * 64 + 63) - w * 64;
+            uint64_t mask = (hi == 63 ? ~uint64_t(0) : (uint64_t(1) << (hi + 1)) - 1)
+                          & ~((uint64_t(1) << lo) - 1);
+            
+            for (int c = c0; c <= c1; c++) {
+                size_t k = static_cast<size_t>(c) * words + w;
+                uint64_t bits = hazardsOnly ? hazard[k] : hazard[k] | solid[k];
+                if (bits & mask) return true;
+            }
+        }
+        return false;
+    }
+};
+
+// ============================================================================
+// MOTION TRACKS
+// ============================================================================
+
+// Triggers fire as the player passes them, so where a moved object is
+// depends only on player x. Each key holds from `px` on, with the offset
+// linear in player x up to the next key; `active` steps at the key.
+struct TrackKey {
+    float px;
+    float dx, dy;
+    uint32_t active;
+};
+
+// The real hitbox of one object at zero offset. Objects moved by the same
+// triggers share their keys.
+struct Track {
+    uint32_t firstKey, keyCount;
+    float x, y, w, h;
+};
+
+struct MotionTracks {
+    std::vector<Track> tracks;
+    std::vector<TrackKey> keys;
+    
+    bool empty() const { return tracks.empty(); }
+    
+    void clear() {
+        tracks.clear();
+        keys.clear();
+    }
+    
+    // Hitbox of track t for a player at px; false while toggled off
+    bool sample(uint32_t t, float px, HitRect& out) const {
+        auto& tr = tracks[t];
+        const TrackKey* first = keys.data() + tr.firstKey;
+        const TrackKey* last = first + tr.keyCount;
+        auto it = std::upper_bound(first + 1, last, px,
+            [](float v, const TrackKey& k) { return v < k.px; });
+        auto& k = *std::prev(it);
+        if (!k.active) return false;
+        
+        float dx = k.dx, dy = k.dy;
+        if (it != last) {
+            float f = (px - k.px) / (it->px - k.px);
+            dx += (it->dx - k.dx) * f;
+            dy += (it->dy - k.dy) * f;
+        }
+        out = {tr.x + dx - tr.w / 2, tr.y + dy - tr.h / 2, tr.w, tr.h};
+        return true;
+    }
+};
+
+// ============================================================================
+// LEVEL
+// ============================================================================
+
+// Extracted level geometry plus the acceleration structures built from it.
+// Filled by LevelAnalyzer in the mod or by the loaders in headless tools,
+// and read-only once finalize() has run.
+class Level {
+public:
+    // Where the speed portals take effect, in x order
+    struct SpeedChange {
+        float x;
+        float speed;
+    };
+    
+    std::vector<LevelObject> objects;
+    MotionTracks motion;
+    SpatialIndex index;
+    OccupancyGrid occupancy;
+    float levelLength = 0;
+    
+    // Derived from `objects` by finalize() and buildPortals(). Mode,
+    // gravity and size portals act on the player boxes touching them.
+    // Speed portals act on x alone, so x stays the same for every state of
+    // a frame whatever was pressed.
+    std::vector<uint32_t> portals;
+    std::vector<SpeedChange> speedChanges;
+    float portalReach = 0;
+    
+    void clear();
+    
+    // Sorts objects by left edge and builds the index and occupancy grid
+    void finalize();
+    
+    // Collects the portals of already sorted objects
+    void buildPortals();
+    
+    // Left edge of the first portal of any kind, or infinity. Before it,
+    // every state is a plain cube.
+    float firstPortalX() const;
+    
+    // Speed multiplier for a player at x
+    float speedAt(float x) const {
+        if (speedChanges.empty() || x < speedChanges.front().x) return 1.0f;
+        auto it = std::upper_bound(speedChanges.begin(), speedChanges.end(), x,
+            [](float v, const SpeedChange& c) { return v < c.x; });
+        return std::prev(it)->speed;
+    }
+    
+    // Calls fn(obj) for each mode, gravity or size portal overlapping r
+    template <class F>
+    void forEachPortal(const HitRect& r, F&& fn) const {
+        if (portals.empty()) return;
+        auto it = std::lower_bound(portals.begin(), portals.end(), r.x - portalReach,
+            [&](uint32_t i, float v) { return objects[i].left() < v; });
+        for (; it != portals.end(); ++it) {
+            auto& obj = objects[*it];
+            if (obj.left() > r.x + r.w) break;
+            if (r.intersects(obj.rect())) fn(obj);
+        }
+    }
+    
+    void logSummary() const;
+    
+    // Calls fn(obj) for each object overlapping r. Stops early if fn
+    // returns false. Moving objects are tested by their swept boxes, so
+    // this is conservative over the whole level run.
+    template <class F>
+    void forEachCandidate(const HitRect& r, F&& fn) const {
+        if (!occupancy.mayOverlap(r)) return;
+        index.query(r.x, r.x + r.w, [&](uint32_t i) {
+            auto& obj = objects[i];
+            if (!r.intersects(obj.rect())) return true;
+            return fn(obj);
+        });
+    }
+    
+    // Like forEachCandidate, but with every moving object where it is when
+    // the player is at px. Those are passed as a copy holding that hitbox.
+    template <class F>
+    void forEachCandidateAt(const HitRect& r, float px, F&& fn) const {
+        if (motion.empty()) {
+            forEachCandidate(r, fn);
+            return;
+        }
+        forEachCandidate(r, [&](const LevelObject& obj) {
+            if (obj.track == NO_TRACK) return fn(obj);
+            HitRect box;
+            if (!motion.sample(obj.track, px, box) || !r.intersects(box)) return true;
+            LevelObject moved = obj;
+            moved.x = box.x + box.w / 2;
+            moved.y = box.y + box.h / 2;
+            moved.w = box.w;
+            moved.h = box.h;
+            return fn(static_cast<const LevelObject&>(moved));
+        });
+    }
+};
@@ -0,0 +1,328 @@
+#include "LevelIO.hpp"
+
+#include "Log.hpp"
+#include "MappedFile.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <system_error>
+
+static constexpr int LEVEL_TEXT_VERSION = 3;
+
+bool saveLevelText(const std::filesystem::path& path, const Level& level) {
+    std::ofstream out(path);
+    if (!out) {
+        LOGE("Can't write level file {}", path.string());
+        return false;
+    }
+    
+    // Enough digits to round-trip every float
+    out.precision(9);
+    out << "gdpf-level " << LEVEL_TEXT_VERSION << "\n";
+    out << "length " << level.levelLength << "\n";
+    out << "motion " << level.motion.tracks.size() << ' ' << level.motion.keys.size() << "\n";
+    for (auto& t : level.motion.tracks) {
+        out << t.x << ' ' << t.y << ' ' << t.w << ' ' << t.h << ' ' << t.firstKey << ' ' << t.keyCount << "\n";
+    }
+    for (auto& k : level.motion.keys) {
+        out << k.px << ' ' << k.dx << ' ' << k.dy << ' ' << k.active << "\n";
+    }
+    for (auto& o : level.objects) {
+        int track = o.track == NO_TRACK ? -1 : static_cast<int>(o.track);
+        out << o.id << ' ' << o.x << ' ' << o.y << ' ' << o.w << ' ' << o.h << ' '
+            << o.isHazard << ' ' << o.isSolid << ' ' << static_cast<int>(o.portal) << ' ' << track << "\n";
+    }
+    return static_cast<bool>(out);
+}
+
+std::shared_ptr<Level> loadLevelText(const std::filesystem::path& path) {
+    std::ifstream in(path);
+    if (!in) {
+        LOGE("Can't open level file {}", path.string());
+        return nullptr;
+    }
+    
+    std::string magic, key;
+    int version = 0;
+    auto level = std::make_shared<Level>();
+    if (!(in >> magic >> version >> key >> level->levelLength) ||
+        magic != "gdpf-level" || version < 1 || version > LEVEL_TEXT_VERSION || key != "length") {
+        LOGE("{} is not a level file", path.string());
+        return nullptr;
+    }
+    
+    // Version 2 files predate motion
+    if (version >= 3) {
+        auto& motion = level->motion;
+        size_t tracks = 0, keys = 0;
+        if (!(in >> key >> tracks >> keys) || key != "motion") {
+            LOGE("Missing motion section in {}", path.string());
+            return nullptr;
+        }
+        motion.tracks.resize(tracks);
+        motion.keys.resize(keys);
+        for (auto& t : motion.tracks) {
+            if (!(in >> t.x >> t.y >> t.w >> t.h >> t.firstKey >> t.keyCount) ||
+                t.keyCount == 0 || t.firstKey > keys || t.keyCount > keys - t.firstKey) {
+                LOGE("Malformed motion track in {}", path.string());
+                return nullptr;
+            }
+        }
+        for (auto& k : motion.keys) {
+            if (!(in >> k.px >> k.dx >> k.dy >> k.active)) {
+                LOGE("Malformed motion key in {}", path.string());
+                return nullptr;
+            }
+        }
+    }
+    
+    // Version 1 files predate portals
+    LevelObject o;
+    int portal = 0;
+    long long track = -1;
+    while (in >> o.id >> o.x >> o.y >> o.w >> o.h >> o.isHazard >> o.isSolid &&
+           (version < 2 || in >> portal) && (version < 3 || in >> track)) {
+        if (portal < 0 || portal > static_cast<int>(Portal::Speed4)) portal = 0;
+        o.portal = static_cast<Portal>(portal);
+        o.track = track >= 0 && static_cast<size_t>(track) < level->motion.tracks.size()
+                      ? static_cast<uint32_t>(track) : NO_TRACK;
+        level->objects.push_back(o);
+    }
+    if (!in.eof()) {
+        LOGE("Malformed object after {} entries in {}", level->objects.size(), path.string());
+        return nullptr;
+    }
+    
+    level->finalize();
+    return level;
+}
+
+// ============================================================================
+// LEVEL CACHE
+// ============================================================================
+
+static constexpr char CACHE_MAGIC[8] = {'G', 'D', 'P', 'F', 'L', 'V', 'C', 0};
+static constexpr uint32_t CACHE_VERSION = 3;
+
+struct CacheHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t objectCount;
+    uint64_t key;
+    float levelLength;
+    uint32_t indexStarts;
+    uint32_t indexItems;
+    int32_t gridCols;
+    int32_t gridRows;
+    int32_t gridWords;
+    uint32_t trackCount;
+    uint32_t keyCount;
+};
+static_assert(sizeof(CacheHeader) == 56, "cache header layout changed");
+
+struct CacheObject {
+    int32_t id;
+    float x, y, w, h;
+    uint8_t isHazard;
+    uint8_t isSolid;
+    uint8_t portal;
+    uint8_t pad;
+    uint32_t track;
+};
+static_assert(sizeof(CacheObject) == 28, "cache object layout changed");
+
+// Tracks and keys are stored as they are in memory
+static_assert(sizeof(Track) == 24, "track layout changed");
+static_assert(sizeof(TrackKey) == 16, "track key layout changed");
+
+static CacheObject cacheRecord(const LevelObject& o) {
+    return {o.id, o.x, o.y, o.w, o.h, o.isHazard, o.isSolid, static_cast<uint8_t>(o.portal), 0, o.track};
+}
+
+template <class T>
+static void writeArray(std::ofstream& out, const std::vector<T>& v) {
+    out.write(reinterpret_cast<const char*>(v.data()), static_cast<std::streamsize>(v.size() * sizeof(T)));
+}
+
+template <class T>
+static bool readArray(ByteReader& in, std::vector<T>& v, size_t count) {
+    if (count > in.remaining() / sizeof(T)) return false;
+    v.resize(count);
+    return in.read(v.data(), count * sizeof(T));
+}
+
+uint64_t hashBytes(const void* data, size_t size, uint64_t seed) {
+    auto p = static_cast<const uint8_t*>(data);
+    uint64_t h = seed;
+    for (size_t i = 0; i < size; i++) {
+        h ^= p[i];
+        h *= 0x100000001b3ull;
+    }
+    return h;
+}
+
+// Levels without motion hash the same as before tracks existed, so replays
+// saved on them still match
+uint64_t hashLevel(const Level& level) {
+    uint64_t h = hashBytes(&level.levelLength, sizeof(level.levelLength));
+    for (auto& o : level.objects) {
+        auto rec = cacheRecord(o);
+        h = hashBytes(&rec, offsetof(CacheObject, track), h);
+        if (o.track != NO_TRACK) h = hashBytes(&rec.track, sizeof(rec.track), h);
+    }
+    if (!level.motion.empty()) {
+        auto& m = level.motion;
+        h = hashBytes(m.tracks.data(), m.tracks.size() * sizeof(Track), h);
+        h = hashBytes(m.keys.data(), m.keys.size() * sizeof(TrackKey), h);
+    }
+    return h;
+}
+
+bool saveLevelCache(const std::filesystem::path& path, const Level& level, uint64_t key) {
+    std::error_code ec;
+    std::filesystem::create_directories(path.parent_path(), ec);
+    
+    // Write next to the target and rename, so a crash never leaves a
+    // truncated cache behind
+    auto tmp = path;
+    tmp += ".tmp";
+    {
+        std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            LOGE("Can't write level cache {}", tmp.string());
+            return false;
+        }
+        
+        CacheHeader h{};
+        std::memcpy(h.magic, CACHE_MAGIC, sizeof(h.magic));
+        h.version = CACHE_VERSION;
+        h.objectCount = static_cast<uint32_t>(level.objects.size());
+        h.key = key;
+        h.levelLength = level.levelLength;
+        h.indexStarts = static_cast<uint32_t>(level.index.colStart.size());
+        h.indexItems = static_cast<uint32_t>(level.index.colItems.size());
+        h.gridCols = level.occupancy.cols;
+        h.gridRows = level.occupancy.rows;
+        h.gridWords = level.occupancy.words;
+        h.trackCount = static_cast<uint32_t>(level.motion.tracks.size());
+        h.keyCount = static_cast<uint32_t>(level.motion.keys.size());
+        out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+        
+        std::vector<CacheObject> objects;
+        objects.reserve(level.objects.size());
+        for (auto& o : level.objects) {
+            objects.push_back(cacheRecord(o));
+        }
+        writeArray(out, objects);
+        writeArray(out, level.motion.tracks);
+        writeArray(out, level.motion.keys);
+        writeArray(out, level.index.colStart);
+        writeArray(out, level.index.colItems);
+        writeArray(out, level.index.firstCol);
+        writeArray(out, level.occupancy.hazard);
+        writeArray(out, level.occupancy.solid);
+        
+        if (!out) {
+            LOGE("Failed writing level cache {}", tmp.string());
+            return false;
+        }
+    }
+    
+    std::filesystem::rename(tmp, path, ec);
+    if (ec) {
+        LOGE("Can't move level cache into place: {}", ec.message());
+        std::filesystem::remove(tmp, ec);
+        return false;
+    }
+    return true;
+}
+
+// CSR offsets that stay inside colItems, items naming real objects, and
+// first columns inside the index
+static bool validIndex(const SpatialIndex& index, uint32_t objectCount) {
+    auto& starts = index.colStart;
+    auto& items = index.colItems;
+    if (starts.empty()) return items.empty() && objectCount == 0;
+    if (starts.front() != 0 || starts.back() != items.size()) return false;
+    for (size_t c = 1; c < starts.size(); c++) {
+        if (starts[c] < starts[c - 1]) return false;
+    }
+    for (uint32_t i : items) {
+        if (i >= objectCount) return false;
+    }
+    int cols = index.columns();
+    for (int c : index.firstCol) {
+        if (c < 0 || c >= cols) return false;
+    }
+    return true;
+}
+
+std::shared_ptr<Level> loadLevelCache(const std::filesystem::path& path, std::optional<uint64_t> key) {
+    MappedFile file;
+    if (!file.open(path)) return nullptr;
+    
+    ByteReader in(file.data(), file.size());
+    CacheHeader h;
+    if (!in.read(h) || std::memcmp(h.magic, CACHE_MAGIC, sizeof(h.magic)) != 0 ||
+        h.version != CACHE_VERSION) {
+        LOGW("Ignoring level cache {} (unknown format)", path.string());
+        return nullptr;
+    }
+    if (key && h.key != *key) {
+        LOGI("Level cache {} is stale", path.string());
+        return nullptr;
+    }
+    
+    auto level = std::make_shared<Level>();
+    level->levelLength = h.levelLength;
+    
+    std::vector<CacheObject> objects;
+    size_t gridSize = static_cast<size_t>(std::max(0, h.gridCols)) * std::max(0, h.gridWords);
+    auto& motion = level->motion;
+    bool ok = readArray(in, objects, h.objectCount)
+           && readArray(in, motion.tracks, h.trackCount)
+           && readArray(in, motion.keys, h.keyCount)
+           && readArray(in, level->index.colStart, h.indexStarts)
+           && readArray(in, level->index.colItems, h.indexItems)
+           && readArray(in, level->index.firstCol, h.objectCount)
+           && readArray(in, level->occupancy.hazard, gridSize)
+           && readArray(in, level->occupancy.solid, gridSize);
+    if (!ok) {
+        LOGW("Ignoring level cache {} (truncated)", path.string());
+        return nullptr;
+    }
+    
+    // Sampling trusts the key ranges, so a bad one rejects the whole file
+    for (auto& t : motion.tracks) {
+        if (t.keyCount == 0 || t.firstKey > h.keyCount || t.keyCount > h.keyCount - t.firstKey) {
+            LOGW("Ignoring level cache {} (bad motion track)", path.string());
+            return nullptr;
+        }
+    }
+    
+    // Queries index these unchecked, so they're validated here as well
+    if (!validIndex(level->index, h.objectCount)) {
+        LOGW("Ignoring level cache {} (bad spatial index)", path.string());
+        return nullptr;
+    }
+    if (h.gridCols < 0 || h.gridRows < 0 || h.gridWords < 0 ||
+        h.gridRows > static_cast<int64_t>(h.gridWords) * 64) {
+        LOGW("Ignoring level cache {} (bad occupancy grid)", path.string());
+        return nullptr;
+    }
+    
+    level->objects.reserve(objects.size());
+    for (auto& o : objects) {
+        Portal portal = o.portal <= static_cast<uint8_t>(Portal::Speed4) ? static_cast<Portal>(o.portal) : Portal::None;
+        uint32_t track = o.track < h.trackCount ? o.track : NO_TRACK;
+        level->objects.push_back({o.id, o.x, o.y, o.w, o.h, o.isHazard != 0, o.isSolid != 0, portal, track});
+    }
+    level->occupancy.cols = h.gridCols;
+    level->occupancy.rows = h.gridRows;
+    level->occupancy.words = h.gridWords;
+    level->buildPortals();
+    return level;
+}
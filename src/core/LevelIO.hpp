@@ -0,0 +1,52 @@
+#pragma once
+
+#include "Level.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <optional>
+
+// ============================================================================
+// LEVEL FILES
+// ============================================================================
+
+// Plain-text level export shared by the mod and the headless tools:
+//
+//   gdpf-level 3
+//   length <levelLength>
+//   motion <tracks> <keys>
+//   <x> <y> <w> <h> <firstKey> <keyCount>          (per track)
+//   <px> <dx> <dy> <active>                        (per key)
+//   <id> <x> <y> <w> <h> <isHazard> <isSolid> <portal> <track>
+//   ...
+//
+// `track` is -1 for an object that doesn't move. Version 2 files, without
+// motion, and version 1 files, without portals either, still load.
+bool saveLevelText(const std::filesystem::path& path, const Level& level);
+
+// Returns a finalized level, or nullptr if the file can't be read
+std::shared_ptr<Level> loadLevelText(const std::filesystem::path& path);
+
+// ============================================================================
+// LEVEL CACHE
+// ============================================================================
+
+// Binary snapshot of a finalized level: objects and motion tracks plus the
+// prebuilt spatial index and occupancy grid, so a cached level loads with a few bulk copies
+// and no scene walk or index build. `key` identifies the level content
+// the cache was built from.
+bool saveLevelCache(const std::filesystem::path& path, const Level& level, uint64_t key);
+
+// Returns nullptr if the file is missing, corrupt, or was built with a
+// different key. Pass no key to accept any.
+std::shared_ptr<Level> loadLevelCache(const std::filesystem::path& path,
+                                      std::optional<uint64_t> key = std::nullopt);
+
+// FNV-1a, chainable through `seed`
+uint64_t hashBytes(const void* data, size_t size, uint64_t seed = 0xcbf29ce484222325ull);
+
+// Hash of the level geometry the search runs on, independent of how the
+// level was obtained
+uint64_t hashLevel(const Level& level);
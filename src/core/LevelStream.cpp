@@ -0,0 +1,167 @@
+#include "LevelStream.hpp"
+
+#include "Log.hpp"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <limits>
+
+using Clock = std::chrono::steady_clock;
+
+void LevelStream::start(std::vector<RawObject> raw, std::vector<RawTrigger> triggers, float levelLength,
+                        CompleteFn onComplete) {
+    cancel();
+    join();
+    m_raw = std::move(raw);
+    m_triggers = std::move(triggers);
+    m_table = std::make_unique<const ObjectTable>(ObjectTable::get());
+    m_objects.clear();
+    m_motion.clear();
+    launch(levelLength, std::move(onComplete));
+}
+
+void LevelStream::start(std::vector<LevelObject> objects, MotionTracks motion, float levelLength,
+                        CompleteFn onComplete) {
+    cancel();
+    join();
+    m_raw.clear();
+    m_triggers.clear();
+    m_objects = std::move(objects);
+    m_motion = std::move(motion);
+    launch(levelLength, std::move(onComplete));
+}
+
+void LevelStream::launch(float levelLength, CompleteFn onComplete) {
+    m_levelLength = levelLength;
+    m_onComplete = std::move(onComplete);
+    m_latest.reset();
+    m_readyX = 0;
+    m_complete = false;
+    m_cancel = false;
+    
+    m_thread = std::thread([this]() {
+        build();
+    });
+}
+
+LevelStream::~LevelStream() {
+    cancel();
+    join();
+}
+
+void LevelStream::cancel() {
+    {
+        std::lock_guard<std::mutex> lock(m_mtx);
+        m_cancel = true;
+    }
+    m_cv.notify_all();
+}
+
+void LevelStream::join() {
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+}
+
+std::shared_ptr<const Level> LevelStream::latest() const {
+    std::lock_guard<std::mutex> lock(m_mtx);
+    return m_latest;
+}
+
+bool LevelStream::waitFor(float x, std::chrono::milliseconds timeout) {
+    std::unique_lock<std::mutex> lock(m_mtx);
+    return m_cv.wait_for(lock, timeout, [&] { return readyX() >= x || cancelled(); }) && !cancelled();
+}
+
+std::shared_ptr<const Level> LevelStream::waitComplete() {
+    std::unique_lock<std::mutex> lock(m_mtx);
+    m_cv.wait(lock, [&] { return complete() || cancelled(); });
+    return complete() ? m_latest : nullptr;
+}
+
+void LevelStream::publish(std::shared_ptr<const Level> level, float readyX, bool complete) {
+    {
+        std::lock_guard<std::mutex> lock(m_mtx);
+        m_latest = std::move(level);
+        m_readyX.store(readyX, std::memory_order_release);
+        m_complete.store(complete, std::memory_order_release);
+    }
+    m_cv.notify_all();
+}
+
+// One table lookup per object, on the build thread. The groups of kept
+// objects are only needed to evaluate the triggers.
+void LevelStream::classify() {
+    auto& table = *m_table;
+    std::array<size_t, OBJECT_KIND_COUNT> kinds{};
+    std::vector<GroupList> groups;
+    m_objects.reserve(m_raw.size());
+    if (!m_triggers.empty()) groups.reserve(m_raw.size());
+    for (auto& r : m_raw) {
+        if (cancelled()) return;
+        kinds[static_cast<size_t>(table.lookup(r.id).kind)]++;
+        LevelObject o;
+        if (!table.classify(r.id, r.place, o)) continue;
+        m_objects.push_back(o);
+        if (!m_triggers.empty()) groups.push_back(r.groups);
+    }
+    m_raw.clear();
+    m_raw.shrink_to_fit();
+    
+    if (!m_triggers.empty()) {
+        m_motion = buildMotion(m_objects, groups, m_triggers, &m_cancel);
+        m_triggers.clear();
+        m_triggers.shrink_to_fit();
+    }
+    
+    auto count = [&](ObjectKind k) { return kinds[static_cast<size_t>(k)]; };
+    LOGI("Classified {} hazards, {} solids, {} portals", count(ObjectKind::Hazard),
+         count(ObjectKind::Solid), count(ObjectKind::Portal));
+    if (count(ObjectKind::Slope) || count(ObjectKind::Orb) || count(ObjectKind::Pad)) {
+        LOGW("Ignoring {} slopes, {} orbs and {} pads the simulator doesn't model",
+             count(ObjectKind::Slope), count(ObjectKind::Orb), count(ObjectKind::Pad));
+    }
+}
+
+void LevelStream::build() {
+    auto t0 = Clock::now();
+    if (!m_raw.empty()) classify();
+    if (cancelled()) return;
+    
+    // The chunks are prefixes in left-edge order, with ties kept in the
+    // order finalize() keeps them
+    auto& objects = m_objects;
+    std::stable_sort(objects.begin(), objects.end(),
+        [](auto& a, auto& b) { return a.left() < b.left(); });
+    
+    // Prefixes by left edge: an object starting past the chunk end can't
+    // touch a player whose hitbox is still inside it
+    size_t chunks = 0;
+    for (float end = FIRST_CHUNK; !cancelled(); end *= 2) {
+        bool last = end >= m_levelLength || objects.empty() || objects.back().left() < end;
+        auto stop = last ? objects.end()
+                         : std::lower_bound(objects.begin(), objects.end(), end,
+                               [](auto& o, float x) { return o.left() < x; });
+        
+        auto level = std::make_shared<Level>();
+        level->objects.assign(objects.begin(), stop);
+        level->motion = m_motion;
+        level->levelLength = m_levelLength;
+        level->finalize();
+        chunks++;
+        
+        if (last) {
+            float ms = std::chrono::duration<float, std::milli>(Clock::now() - t0).count();
+            LOGI("Level built in {} chunks, {:.0f} ms", chunks, ms);
+            if (cancelled()) return;
+            if (m_onComplete) m_onComplete(*level);
+            publish(std::move(level), std::numeric_limits<float>::infinity(), true);
+            objects.clear();
+            objects.shrink_to_fit();
+            m_motion.clear();
+            return;
+        }
+        publish(std::move(level), end, false);
+    }
+}
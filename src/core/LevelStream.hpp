@@ -0,0 +1,103 @@
+#pragma once
+
+#include "Level.hpp"
+#include "ObjectTable.hpp"
+#include "Triggers.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// ============================================================================
+// LEVEL STREAM
+// ============================================================================
+
+// Scene data of one object, copied on the main thread without classifying
+struct RawObject {
+    int id = 0;
+    ObjectPlacement place;
+    GroupList groups;
+};
+
+// Turns a raw snapshot into a Level on a background thread, in X order.
+// Each chunk publishes a finalized level holding every object whose left
+// edge lies below readyX(), so a search can run on the start of the level
+// while the rest is still being built. Chunks start at FIRST_CHUNK wide and
+// double, which keeps the total rebuild work under twice one full build.
+// Triggers are evaluated into motion tracks once, before the first chunk,
+// and every chunk carries all of them. Raw objects are classified with a
+// copy of the object table taken at start(), so the table can be reloaded
+// while a cancelled stream is still winding down.
+class LevelStream {
+public:
+    static constexpr float FIRST_CHUNK = 16 * Physics::BLOCK;
+    
+    // Called on the build thread with the complete level
+    using CompleteFn = std::function<void(const Level&)>;
+    
+    LevelStream() = default;
+    LevelStream(const LevelStream&) = delete;
+    LevelStream& operator=(const LevelStream&) = delete;
+    
+    ~LevelStream();
+    
+    // `levelLength` is the full length, known before any object is converted
+    void start(std::vector<RawObject> raw, std::vector<RawTrigger> triggers, float levelLength,
+               CompleteFn onComplete = {});
+    
+    // Streams objects that are already classified, such as a loaded level,
+    // with the motion tracks their `track` fields refer to
+    void start(std::vector<LevelObject> objects, MotionTracks motion, float levelLength,
+               CompleteFn onComplete = {});
+    
+    // Stops building without waiting for the build thread, which notices
+    // within one object or chunk; a cancelled stream never completes. The
+    // destructor and start() wait for the thread to exit.
+    void cancel();
+    
+    // Newest published level, or nullptr before the first chunk
+    std::shared_ptr<const Level> latest() const;
+    
+    // Objects are final up to here; infinite once complete
+    float readyX() const { return m_readyX.load(std::memory_order_acquire); }
+    bool complete() const { return m_complete.load(std::memory_order_acquire); }
+    bool cancelled() const { return m_cancel.load(std::memory_order_acquire); }
+    float levelLength() const { return m_levelLength; }
+    
+    // Waits up to `timeout` for readyX() to pass `x`. Returns true once it
+    // has, false on timeout or if the stream was cancelled.
+    bool waitFor(float x, std::chrono::milliseconds timeout);
+    
+    // Blocks until the whole level is built; nullptr if cancelled
+    std::shared_ptr<const Level> waitComplete();
+    
+private:
+    std::vector<RawObject> m_raw;
+    std::vector<RawTrigger> m_triggers;
+    std::unique_ptr<const ObjectTable> m_table;
+    std::vector<LevelObject> m_objects;
+    MotionTracks m_motion;
+    float m_levelLength = 0;
+    CompleteFn m_onComplete;
+    
+    mutable std::mutex m_mtx;
+    std::condition_variable m_cv;
+    std::shared_ptr<const Level> m_latest;
+    std::atomic<float> m_readyX{0};
+    std::atomic<bool> m_complete{false};
+    std::atomic<bool> m_cancel{false};
+    std::thread m_thread;
+    
+    void join();
+    void launch(float levelLength, CompleteFn onComplete);
+    void build();
+    void classify();
+    void publish(std::shared_ptr<const Level> level, float readyX, bool complete);
+};
@@ -0,0 +1,98 @@
+#include "Lockstep.hpp"
+
+#include "Log.hpp"
+#include "Pathfinder.hpp"
+
+// Samples logged before the first divergence
+static constexpr size_t REPORT_LEAD = 16;
+
+void LockstepVerifier::reset(std::shared_ptr<const Level> level, const BatchPhysics::Tick& tick, LockstepTolerance tol) {
+    m_level = std::move(level);
+    m_physics = tick;
+    m_tol = tol;
+    m_sim = SimState{};
+    m_ticks = 0;
+    m_held = false;
+    m_hasOrigin = false;
+    m_originX = 0;
+    
+    m_history.resize(HISTORY);
+    m_lead.reserve(HISTORY);
+    m_lead.clear();
+    m_next = 0;
+    m_count = 0;
+    
+    m_diverged = false;
+    m_first = LockstepSample{};
+    m_maxPos = 0;
+    m_maxVel = 0;
+}
+
+void LockstepVerifier::step(bool held) {
+    if (!m_level) return;
+    m_held = held;
+    m_ticks++;
+    if (!m_sim.dead) {
+        SimplePathfinder::simulateFrame(m_sim, held, *m_level, m_physics);
+    }
+}
+
+void LockstepVerifier::observe(float x, float y, float velY) {
+    if (!m_level) return;
+    
+    // The game doesn't start the player at x = 0
+    if (!m_hasOrigin) {
+        m_originX = x - m_sim.x;
+        m_hasOrigin = true;
+    }
+    
+    LockstepSample s;
+    s.tick = m_ticks;
+    s.simX = m_sim.x;
+    s.simY = m_sim.y;
+    s.simVelY = m_sim.velY;
+    s.realX = x - m_originX;
+    s.realY = y;
+    s.realVelY = velY;
+    s.held = m_held;
+    s.simDead = m_sim.dead;
+    
+    m_history[m_next] = s;
+    m_next = (m_next + 1) % HISTORY;
+    m_count++;
+    
+    float pos = s.posError(), vel = s.velError();
+    m_maxPos = std::max(m_maxPos, pos);
+    m_maxVel = std::max(m_maxVel, vel);
+    
+    if (!m_diverged && (s.simDead || pos > m_tol.pos || vel > m_tol.vel)) {
+        m_diverged = true;
+        m_first = s;
+        m_lead.clear();
+        forEachSample([&](const LockstepSample& h) { m_lead.push_back(h); });
+        LOGW("Lockstep: simulator diverged at tick {} (position error {:.3f}, velocity error {:.3f}{})",
+             s.tick, pos, vel, s.simDead ? ", simulated player died" : "");
+    }
+}
+
+void LockstepVerifier::report() const {
+    if (m_count == 0) return;
+    
+    if (!m_diverged) {
+        LOGI("Lockstep: {} ticks, {} samples within tolerance (max position error {:.3f}, max velocity error {:.3f})",
+             m_ticks, m_count, m_maxPos, m_maxVel);
+        return;
+    }
+    
+    auto& f = m_first;
+    LOGI("Lockstep: first divergence at tick {}: sim ({:.2f}, {:.2f}, v {:.3f}) game ({:.2f}, {:.2f}, v {:.3f})",
+         f.tick, f.simX, f.simY, f.simVelY, f.realX, f.realY, f.realVelY);
+    LOGI("Lockstep: max position error {:.3f}, max velocity error {:.3f} over {} ticks", m_maxPos, m_maxVel, m_ticks);
+    
+    size_t begin = m_lead.size() > REPORT_LEAD ? m_lead.size() - REPORT_LEAD : 0;
+    for (size_t i = begin; i < m_lead.size(); i++) {
+        auto& s = m_lead[i];
+        LOGI("  tick {:6} {} dx {:+.3f} dy {:+.3f} dv {:+.3f}", s.tick, s.held ? "held" : "    ",
+             s.realX - s.simX, s.realY - s.simY, s.realVelY - s.simVelY);
+    }
+}
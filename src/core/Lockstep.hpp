@@ -0,0 +1,97 @@
+#pragma once
+
+#include "BatchPhysics.hpp"
+#include "Level.hpp"
+#include "Physics.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// ============================================================================
+// LOCKSTEP VERIFIER
+// ============================================================================
+
+// One comparison between the simulator and the game, taken after the game
+// has run its physics for a frame. `tick` counts simulator ticks so far.
+struct LockstepSample {
+    uint32_t tick = 0;
+    float simX = 0, simY = 0, simVelY = 0;
+    float realX = 0, realY = 0, realVelY = 0;
+    bool held = false;
+    bool simDead = false;
+    
+    float posError() const { return std::hypot(realX - simX, realY - simY); }
+    float velError() const { return std::abs(realVelY - simVelY); }
+};
+
+// How far the simulator may drift from the game before it counts
+struct LockstepTolerance {
+    float pos = 1.0f;   // units
+    float vel = 0.5f;   // velocity units (per 1/60 s)
+};
+
+// Runs the simulator next to the real player on the same inputs and keeps
+// the most recent comparisons in a fixed ring, so instrumenting a replay
+// doesn't allocate per frame. The first sample outside the tolerances is
+// kept separately, since that's where the simulator went wrong.
+class LockstepVerifier {
+public:
+    static constexpr size_t HISTORY = 512;
+    
+    void reset(std::shared_ptr<const Level> level, const BatchPhysics::Tick& tick,
+               LockstepTolerance tol = LockstepTolerance());
+    
+    bool active() const { return m_level != nullptr; }
+    
+    // Advances the simulator by one tick with the button `held`
+    void step(bool held);
+    
+    // Compares against where the game put the player after the same ticks.
+    // The first call only records the offset between the two x origins.
+    void observe(float x, float y, float velY);
+    
+    bool diverged() const { return m_diverged; }
+    const LockstepSample& firstDivergence() const { return m_first; }
+    uint32_t ticks() const { return m_ticks; }
+    size_t samples() const { return m_count; }
+    
+    // Oldest to newest
+    template <class F>
+    void forEachSample(F&& fn) const {
+        size_t n = std::min(m_count, HISTORY);
+        for (size_t i = 0; i < n; i++) {
+            fn(m_history[(m_next + HISTORY - n + i) % HISTORY]);
+        }
+    }
+    
+    // Logs the first divergence and the samples leading up to it, or the
+    // largest error seen if the run stayed within tolerance
+    void report() const;
+    
+    void stop() { m_level.reset(); }
+    
+private:
+    std::shared_ptr<const Level> m_level;
+    BatchPhysics::Tick m_physics = BatchPhysics::DEFAULT_TICK;
+    LockstepTolerance m_tol;
+    SimState m_sim;
+    uint32_t m_ticks = 0;
+    bool m_held = false;
+    
+    bool m_hasOrigin = false;
+    float m_originX = 0;
+    
+    std::vector<LockstepSample> m_history;
+    size_t m_next = 0;
+    size_t m_count = 0;
+    
+    bool m_diverged = false;
+    LockstepSample m_first;
+    std::vector<LockstepSample> m_lead;   // history up to the divergence
+    float m_maxPos = 0;
+    float m_maxVel = 0;
+};
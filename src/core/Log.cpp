@@ -0,0 +1,23 @@
+#include "Log.hpp"
+
+#include <atomic>
+#include <cstdio>
+
+namespace Log {
+    namespace {
+        void stderrSink(Level level, const std::string& msg) {
+            static const char* names[] = {"DEBUG", "INFO", "WARN", "ERROR"};
+            std::fprintf(stderr, "[%s] %s\n", names[static_cast<int>(level)], msg.c_str());
+        }
+        
+        std::atomic<Sink> g_sink{stderrSink};
+    }
+    
+    void setSink(Sink sink) {
+        g_sink = sink ? sink : stderrSink;
+    }
+    
+    void write(Level level, const std::string& msg) {
+        g_sink.load()(level, msg);
+    }
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <fmt/format.h>
+
+#include <string>
+
+// ============================================================================
+// SIMPLE LOGGING
+// ============================================================================
+
+// Core code logs through a replaceable sink: the mod routes it into the
+// Geode log, headless tools print to stderr.
+namespace Log {
+    enum class Level { Debug, Info, Warn, Error };
+    
+    using Sink = void (*)(Level level, const std::string& msg);
+    
+    void setSink(Sink sink);
+    void write(Level level, const std::string& msg);
+}
+
+#define LOGD(...) ::Log::write(::Log::Level::Debug, fmt::format(__VA_ARGS__))
+#define LOGI(...) ::Log::write(::Log::Level::Info, fmt::format(__VA_ARGS__))
+#define LOGW(...) ::Log::write(::Log::Level::Warn, fmt::format(__VA_ARGS__))
+#define LOGE(...) ::Log::write(::Log::Level::Error, fmt::format(__VA_ARGS__))
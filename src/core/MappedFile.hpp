@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+
+// ============================================================================
+// MAPPED FILE
+// ============================================================================
+
+// Read-only memory map of a whole file
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+    
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    
+    bool open(const std::filesystem::path& path);
+    void close();
+    
+    const uint8_t* data() const { return m_data; }
+    size_t size() const { return m_size; }
+    
+private:
+    const uint8_t* m_data = nullptr;
+    size_t m_size = 0;
+#if defined(_WIN32)
+    void* m_file = nullptr;
+    void* m_mapping = nullptr;
+#endif
+};
+
+// Bounds-checked sequential reader over a byte range
+class ByteReader {
+public:
+    ByteReader(const uint8_t* data, size_t size) : m_data(data), m_size(size) {}
+    
+    bool read(void* dst, size_t n);
+    
+    template <class T>
+    bool read(T& value) {
+        return read(&value, sizeof(T));
+    }
+    
+    size_t remaining() const { return m_size - m_pos; }
+    
+private:
+    const uint8_t* m_data;
+    size_t m_size;
+    size_t m_pos = 0;
+};
@@ -0,0 +1,250 @@
+#include "ObjectTable.hpp"
+
+#include "LevelIO.hpp"
+#include "Log.hpp"
+
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <utility>
+
+// ============================================================================
+// BUILT-IN ENTRIES
+// ============================================================================
+
+struct ObjectRange {
+    int first, last;
+    ObjectInfo info;
+};
+
+static constexpr ObjectInfo hazard(float w, float h, float offY = 0) {
+    return {ObjectKind::Hazard, Portal::None, w, h, 0, offY};
+}
+
+static constexpr ObjectInfo solid(float w, float h, float offY = 0) {
+    return {ObjectKind::Solid, Portal::None, w, h, 0, offY};
+}
+
+static constexpr ObjectInfo of(ObjectKind kind, float w, float h, float offY = 0) {
+    return {kind, Portal::None, w, h, 0, offY};
+}
+
+static constexpr ObjectInfo portalInfo(Portal p, float w, float h) {
+    return {ObjectKind::Portal, p, w, h, 0, 0};
+}
+
+static constexpr float B = Physics::BLOCK;
+
+// Hitboxes are the game's, not the sprite's: spikes only hurt near
+// their middle and saws are approximated by the square inside their
+// circle. Later entries win where ranges overlap.
+static constexpr ObjectRange BUILTIN[] = {
+    // Blocks and slabs
+    {1, 7, solid(B, B)},
+    {40, 40, solid(B, 14, 8)},
+    {41, 50, solid(B, B)},
+    {62, 66, solid(B, B)},
+    {68, 69, solid(B, B)},
+    {83, 83, solid(B, B)},
+    
+    // Spikes
+    {8, 8, hazard(6, 12)},
+    {39, 39, hazard(6, 5.6f, -4)},
+    {103, 103, hazard(4, 7.6f, -3)},
+    {135, 135, hazard(9, 8, -4)},
+    {392, 392, hazard(2.6f, 4.8f, -5)},
+    {216, 216, hazard(6, 12)},
+    {217, 217, hazard(6, 5.6f, -4)},
+    {218, 218, hazard(4, 7.6f, -3)},
+    {458, 459, hazard(6, 12)},
+    
+    // Saws
+    {88, 88, hazard(46, 46)},
+    {89, 89, hazard(31, 31)},
+    {98, 98, hazard(17, 17)},
+    {397, 397, hazard(46, 46)},
+    {398, 398, hazard(31, 31)},
+    {399, 399, hazard(17, 17)},
+    {678, 678, hazard(46, 46)},
+    {679, 679, hazard(31, 31)},
+    {680, 680, hazard(17, 17)},
+    {740, 740, hazard(46, 46)},
+    {741, 741, hazard(31, 31)},
+    {742, 742, hazard(17, 17)},
+    {1619, 1619, hazard(46, 46)},
+    {1620, 1620, hazard(31, 31)},
+    
+    // Slopes
+    {289, 289, of(ObjectKind::Slope, B, B)},
+    {291, 291, of(ObjectKind::Slope, 2 * B, B)},
+    {294, 297, of(ObjectKind::Slope, B, B)},
+    {299, 301, of(ObjectKind::Slope, 2 * B, B)},
+    
+    // Pads and orbs
+    {35, 35, of(ObjectKind::Pad, 25, 4, -13)},
+    {67, 67, of(ObjectKind::Pad, 25, 4, -13)},
+    {140, 140, of(ObjectKind::Pad, 25, 4, -13)},
+    {1332, 1332, of(ObjectKind::Pad, 25, 4, -13)},
+    {3005, 3005, of(ObjectKind::Pad, 25, 4, -13)},
+    {36, 36, of(ObjectKind::Orb, 36, 36)},
+    {84, 84, of(ObjectKind::Orb, 36, 36)},
+    {141, 141, of(ObjectKind::Orb, 36, 36)},
+    {1022, 1022, of(ObjectKind::Orb, 36, 36)},
+    {1330, 1330, of(ObjectKind::Orb, 36, 36)},
+    {1333, 1333, of(ObjectKind::Orb, 36, 36)},
+    {1704, 1704, of(ObjectKind::Orb, 36, 36)},
+    {1751, 1751, of(ObjectKind::Orb, 36, 36)},
+    {3004, 3004, of(ObjectKind::Orb, 36, 36)},
+    
+    // Portals
+    {12, 12, portalInfo(Portal::Cube, 34, 86)},
+    {13, 13, portalInfo(Portal::Ship, 34, 86)},
+    {47, 47, portalInfo(Portal::Ball, 34, 86)},
+    {111, 111, portalInfo(Portal::Ufo, 34, 86)},
+    {660, 660, portalInfo(Portal::Wave, 34, 86)},
+    {745, 745, portalInfo(Portal::Robot, 34, 86)},
+    {1331, 1331, portalInfo(Portal::Spider, 34, 86)},
+    {1933, 1933, portalInfo(Portal::Swing, 34, 86)},
+    {10, 10, portalInfo(Portal::GravityDown, 25, 75)},
+    {11, 11, portalInfo(Portal::GravityUp, 25, 75)},
+    {99, 99, portalInfo(Portal::SizeNormal, 31, 90)},
+    {101, 101, portalInfo(Portal::SizeMini, 31, 90)},
+    {200, 200, portalInfo(Portal::Speed0, 35, 44)},
+    {201, 201, portalInfo(Portal::Speed1, 33, 56)},
+    {202, 202, portalInfo(Portal::Speed2, 51, 56)},
+    {203, 203, portalInfo(Portal::Speed3, 65, 56)},
+    {1334, 1334, portalInfo(Portal::Speed4, 69, 56)},
+};
+
+static constexpr std::array<ObjectInfo, ObjectTable::MAX_ID> buildTable() {
+    std::array<ObjectInfo, ObjectTable::MAX_ID> table{};
+    for (auto& r : BUILTIN) {
+        for (int id = r.first; id <= r.last; id++) table[id] = r.info;
+    }
+    return table;
+}
+
+static constexpr auto BUILTIN_TABLE = buildTable();
+
+static_assert(BUILTIN_TABLE[8].kind == ObjectKind::Hazard, "spike missing from the object table");
+static_assert(BUILTIN_TABLE[47].kind == ObjectKind::Portal, "ball portal classified as a block");
+static_assert(BUILTIN_TABLE[1334].portal == Portal::Speed4, "4x speed portal missing");
+
+static constexpr const char* KIND_NAMES[OBJECT_KIND_COUNT] = {
+    "none", "hazard", "solid", "slope", "orb", "pad", "portal",
+};
+
+const char* objectKindName(ObjectKind kind) {
+    auto i = static_cast<size_t>(kind);
+    return i < OBJECT_KIND_COUNT ? KIND_NAMES[i] : "unknown";
+}
+
+// ============================================================================
+// OBJECT TABLE
+// ============================================================================
+
+ObjectTable& ObjectTable::get() {
+    static ObjectTable instance;
+    return instance;
+}
+
+ObjectTable::ObjectTable() : m_entries(BUILTIN_TABLE) {}
+
+void ObjectTable::reset() {
+    m_entries = BUILTIN_TABLE;
+    m_revision = 0;
+    m_overrides = 0;
+}
+
+bool ObjectTable::classify(int id, const ObjectPlacement& p, LevelObject& out) const {
+    auto& info = lookup(id);
+    if (info.kind != ObjectKind::Hazard && info.kind != ObjectKind::Solid &&
+        info.kind != ObjectKind::Portal) {
+        return false;
+    }
+    
+    float w = info.w * std::abs(p.scaleX);
+    float h = info.h * std::abs(p.scaleY);
+    float ox = info.offX * p.scaleX * (p.flipX ? -1 : 1);
+    float oy = info.offY * p.scaleY * (p.flipY ? -1 : 1);
+    
+    // Quarter turns clockwise
+    int quarter = static_cast<int>(std::lround(p.rotation / 90)) & 3;
+    for (int q = 0; q < quarter; q++) {
+        std::swap(w, h);
+        ox = std::exchange(oy, -ox);
+    }
+    
+    out.id = id;
+    out.x = p.x + ox;
+    out.y = p.y + oy;
+    out.w = w;
+    out.h = h;
+    out.isHazard = info.kind == ObjectKind::Hazard;
+    out.isSolid = info.kind == ObjectKind::Solid;
+    out.portal = info.kind == ObjectKind::Portal ? info.portal : Portal::None;
+    return true;
+}
+
+bool ObjectTable::loadOverrides(const std::filesystem::path& path) {
+    reset();
+    
+    std::ifstream in(path);
+    if (!in) {
+        LOGE("Can't open object table {}", path.string());
+        return false;
+    }
+    
+    std::string line, magic;
+    int version = 0;
+    if (!std::getline(in, line) || !(std::istringstream(line) >> magic >> version) ||
+        magic != "gdpf-objects" || version != 1) {
+        LOGE("{} is not an object table", path.string());
+        return false;
+    }
+    
+    auto entries = m_entries;
+    uint64_t revision = hashBytes(nullptr, 0);
+    size_t count = 0;
+    for (int lineNo = 2; std::getline(in, line); lineNo++) {
+        auto start = line.find_first_not_of(" \t\r");
+        if (start == std::string::npos || line[start] == '#') continue;
+        
+        std::istringstream fields(line);
+        int id = 0, portal = 0;
+        std::string kindName;
+        ObjectInfo info;
+        if (!(fields >> id >> kindName >> info.w >> info.h >> info.offX >> info.offY >> portal)) {
+            LOGE("Malformed entry on line {} of {}", lineNo, path.string());
+            return false;
+        }
+        
+        int kind = 0;
+        while (kind < OBJECT_KIND_COUNT && kindName != KIND_NAMES[kind]) kind++;
+        if (id <= 0 || id >= MAX_ID || kind == OBJECT_KIND_COUNT ||
+            portal < 0 || portal > static_cast<int>(Portal::Speed4) ||
+            (kind == static_cast<int>(ObjectKind::Portal)) != (portal != 0) ||
+            !(info.w >= 0) || !(info.h >= 0)) {
+            LOGE("Invalid entry for ID {} on line {} of {}", id, lineNo, path.string());
+            return false;
+        }
+        info.kind = static_cast<ObjectKind>(kind);
+        info.portal = static_cast<Portal>(portal);
+        entries[id] = info;
+        
+        revision = hashBytes(&id, sizeof(id), revision);
+        revision = hashBytes(&info.kind, sizeof(info.kind), revision);
+        revision = hashBytes(&info.portal, sizeof(info.portal), revision);
+        for (float v : {info.w, info.h, info.offX, info.offY}) {
+            revision = hashBytes(&v, sizeof(v), revision);
+        }
+        count++;
+    }
+    
+    m_entries = entries;
+    m_revision = count ? revision : 0;
+    m_overrides = count;
+    LOGI("Object table: {} overrides from {}", count, path.string());
+    return true;
+}
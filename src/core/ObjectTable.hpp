@@ -0,0 +1,84 @@
+#pragma once
+
+#include "Level.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+
+// ============================================================================
+// OBJECT TABLE
+// ============================================================================
+
+// How the player interacts with an object. Only hazards, solids and portals
+// are simulated; slopes, orbs and pads are recognised so the analyzer can
+// report what a level uses that the search can't handle yet.
+enum class ObjectKind : uint8_t {
+    None, Hazard, Solid, Slope, Orb, Pad, Portal,
+};
+
+constexpr int OBJECT_KIND_COUNT = 7;
+
+const char* objectKindName(ObjectKind kind);
+
+// Collision data for one object ID. The hitbox is in units at scale 1,
+// centred on the object position plus the offset.
+struct ObjectInfo {
+    ObjectKind kind = ObjectKind::None;
+    Portal portal = Portal::None;
+    float w = 0, h = 0;
+    float offX = 0, offY = 0;
+};
+
+// Where an object sits in the level, as read from the scene. Rotation is
+// in degrees, clockwise, and snapped to quarter turns.
+struct ObjectPlacement {
+    float x = 0, y = 0;
+    float scaleX = 1, scaleY = 1;
+    float rotation = 0;
+    bool flipX = false, flipY = false;
+};
+
+// Dense lookup from object ID to collision data, built at compile time
+// from the list in ObjectTable.cpp. A data file can add or override
+// entries at runtime, so new IDs don't need a rebuild:
+//
+//   gdpf-objects 1
+//   <id> <kind> <w> <h> <offX> <offY> <portal>
+//   ...
+//
+// `kind` is a name from objectKindName() and `portal` a Portal value (0
+// unless the kind is portal). Lines starting with '#' are comments.
+class ObjectTable {
+public:
+    static constexpr int MAX_ID = 5000;
+    
+    static ObjectTable& get();
+    
+    const ObjectInfo& lookup(int id) const {
+        return id > 0 && id < MAX_ID ? m_entries[id] : m_entries[0];
+    }
+    
+    // Fills `out` for a simulated object and returns true; every other
+    // kind, including unknown IDs, returns false
+    bool classify(int id, const ObjectPlacement& p, LevelObject& out) const;
+    
+    // Reverts to the built-in table, then applies the entries in `path`.
+    // A malformed file leaves the built-in table in place.
+    bool loadOverrides(const std::filesystem::path& path);
+    
+    void reset();
+    
+    // Changes whenever loaded overrides change what the table says, for
+    // keying caches of extracted levels. Zero for the built-in table.
+    uint64_t revision() const { return m_revision; }
+    size_t overrides() const { return m_overrides; }
+    
+private:
+    ObjectTable();
+    
+    std::array<ObjectInfo, MAX_ID> m_entries;
+    uint64_t m_revision = 0;
+    size_t m_overrides = 0;
+};
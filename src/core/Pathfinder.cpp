@@ -0,0 +1,1328 @@
+#include "Pathfinder.hpp"
+
+#include "BatchPhysics.hpp"
+#include "LevelIO.hpp"
+#include "Log.hpp"
+
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <system_error>
+
+using Clock = std::chrono::steady_clock;
+
+static uint64_t nsSince(Clock::time_point t) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - t).count();
+}
+
+// Counts a reallocation whenever a buffer's capacity changed since last time
+static void trackCapacity(size_t now, size_t& last, uint64_t& allocations) {
+    if (now != last) {
+        allocations++;
+        last = now;
+    }
+}
+
+bool SimplePathfinder::prepare(std::shared_ptr<const Level> level, const SearchConfig& cfg, bool resume,
+                               std::vector<bool> seed) {
+    // A stopped search may still be winding down; never wait for it here
+    if (busy()) return false;
+    
+    if (!level) {
+        LOGE("Level not analyzed!");
+        return false;
+    }
+    
+    // A finished search leaves its thread joinable, and joins at once
+    if (worker.joinable()) {
+        worker.join();
+    }
+    
+    // Never resume from a checkpoint that is still being written
+    checkpointWriter.flush();
+    
+    levelHash = hashLevel(*level);
+    resuming = false;
+    if (resume) {
+        if (cfg.checkpointPath.empty() || !loadCheckpoint(cfg.checkpointPath, checkpointBuf)) {
+            LOGE("No checkpoint to resume from");
+            return false;
+        }
+        if (checkpointBuf.levelHash != levelHash) {
+            LOGE("Checkpoint {} belongs to a different level", cfg.checkpointPath.string());
+            return false;
+        }
+        // Checkpoints store the clamped rate the search actually ran at
+        int tickRate = std::clamp(cfg.tickRate, BatchPhysics::MIN_TICK_RATE, BatchPhysics::MAX_TICK_RATE);
+        if (checkpointBuf.tickRate != tickRate) {
+            LOGE("Checkpoint {} was searched at {} ticks/s, not {}",
+                 cfg.checkpointPath.string(), checkpointBuf.tickRate, tickRate);
+            return false;
+        }
+        resuming = true;
+    }
+    seedInputs = std::move(seed);
+    
+    m_stream.reset();
+    config = cfg;
+    config.tickRate = std::clamp(cfg.tickRate, BatchPhysics::MIN_TICK_RATE, BatchPhysics::MAX_TICK_RATE);
+    tick = BatchPhysics::Tick::at(config.tickRate);
+    m_level = std::move(level);
+    scorer = StateScorer(*m_level, config.heuristic, tick);
+    LOGI("Beam width {} (adaptive: {}, budget {} MB), {} threads, {} heuristic, {} ticks/s",
+         config.beamWidth, config.adaptiveBeam, config.memoryBudgetMB, config.threadCount(),
+         heuristicName(config.heuristic.kind), config.tickRate);
+    if (config.beamWidth > maxWidthForBudget()) {
+        LOGW("Beam width {} doesn't fit the {} MB budget ({} MB cap), searching at most {} wide",
+             config.beamWidth, config.memoryBudgetMB, config.memoryCapMB, maxWidthForBudget());
+    }
+    
+    if (!pool || pool->size() != config.threadCount()) {
+        pool = std::make_unique<ThreadPool>(config.threadCount());
+    }
+    
+    running = true;
+    active.store(true, std::memory_order_release);
+    found = false;
+    progress = 0;
+    solution.clear();
+    refined.clear();
+    stats = SearchStats{};
+    physicsNs = 0;
+    collideNs = 0;
+    
+    // No search is running, so this thread may act as producer
+    runId++;
+    version = 0;
+    lastCommitted = 0;
+    auto& snap = snapshots.back();
+    snap = SearchSnapshot{};
+    snap.run = runId;
+    snap.tickRate = config.tickRate;
+    snapshots.publish();
+    return true;
+}
+
+bool SimplePathfinder::start(std::shared_ptr<const Level> level, const SearchConfig& cfg, bool resume) {
+    if (!prepare(std::move(level), cfg, resume)) return false;
+    
+    worker = std::thread([this]() {
+        runSearch();
+    });
+    return true;
+}
+
+bool SimplePathfinder::start(std::shared_ptr<const Level> level, const SearchConfig& cfg, std::vector<bool> seed) {
+    if (!prepare(std::move(level), cfg, false, std::move(seed))) return false;
+    
+    worker = std::thread([this]() {
+        runSearch();
+    });
+    return true;
+}
+
+bool SimplePathfinder::start(std::shared_ptr<LevelStream> stream, const SearchConfig& cfg) {
+    if (!stream || stream->cancelled()) {
+        LOGE("Level not analyzed!");
+        return false;
+    }
+    if (stream->complete()) return start(stream->latest(), cfg);
+    
+    // Nothing may be built yet: start on an empty level of the right
+    // length, and let the search thread pick up the chunks
+    auto placeholder = std::make_shared<Level>();
+    placeholder->levelLength = stream->levelLength();
+    placeholder->finalize();
+    if (!prepare(std::move(placeholder), cfg, false)) return false;
+    m_stream = std::move(stream);
+    
+    worker = std::thread([this]() {
+        runSearch();
+    });
+    return true;
+}
+
+bool SimplePathfinder::run(std::shared_ptr<const Level> level, const SearchConfig& cfg, bool resume) {
+    if (!prepare(std::move(level), cfg, resume)) return false;
+    runSearch();
+    return true;
+}
+
+bool SimplePathfinder::run(std::shared_ptr<const Level> level, const SearchConfig& cfg, std::vector<bool> seed) {
+    if (!prepare(std::move(level), cfg, false, std::move(seed))) return false;
+    runSearch();
+    return true;
+}
+
+void SimplePathfinder::requestStop(StoppedFn fn) {
+    {
+        std::lock_guard<std::mutex> lock(stopMtx);
+        if (busy()) {
+            if (fn) onStopped.push_back(std::move(fn));
+            running = false;
+            return;
+        }
+    }
+    if (fn) fn();
+}
+
+void SimplePathfinder::stop() {
+    requestStop();
+    wait();
+}
+
+// Every search ends here, with its final snapshot already published
+void SimplePathfinder::runSearch() {
+    findPath();
+    
+    std::vector<StoppedFn> callbacks;
+    {
+        std::lock_guard<std::mutex> lock(stopMtx);
+        callbacks.swap(onStopped);
+        running = false;
+        active.store(false, std::memory_order_release);
+    }
+    for (auto& fn : callbacks) fn();
+}
+
+void SimplePathfinder::wait() {
+    if (worker.joinable()) {
+        worker.join();
+    }
+}
+
+void SimplePathfinder::publish(const BeamSoA& beam, int frame, float bestX, int width, bool finished) {
+    auto& snap = snapshots.back();
+    snap.run = runId;
+    snap.version = ++version;
+    snap.frame = frame;
+    snap.bestX = bestX;
+    snap.progress = progress;
+    snap.beamSize = beam.size();
+    snap.width = width;
+    snap.nodes = tree.size();
+    snap.stats = currentStats();
+    snap.tickRate = config.tickRate;
+    snap.finished = finished;
+    snap.found = found;
+    
+    snap.refined = refined;
+    snap.margin = refined.empty() ? -1 : refineReport.minMargin();
+    if (found) {
+        snap.prefix = solution;
+        snap.committed = solution.size();
+    } else if (!beam.empty()) {
+        snap.prefix = tree.rebuild(beam.node[0]);
+        if (trackCommitted) {
+            ancestorScratch.assign(beam.node.begin(), beam.node.end());
+            lastCommitted = tree.commonAncestorDepth(ancestorScratch, snap.prefix.size(), lastCommitted);
+        }
+        snap.committed = lastCommitted;
+    } else {
+        snap.prefix.clear();
+        snap.committed = 0;
+    }
+    
+    snapshots.publish();
+}
+
+// Compacts the beam and its input paths into checkpointBuf and hands it to
+// the writer thread; the disk write happens off the search thread
+void SimplePathfinder::checkpoint(const BeamSoA& beam, int frame, float bestX, int width) {
+    auto& cp = checkpointBuf;
+    cp.levelHash = levelHash;
+    cp.tickRate = config.tickRate;
+    cp.frame = frame;
+    cp.bestX = bestX;
+    cp.width = width;
+    cp.beam = beam;
+    tree.extract(cp.beam.node, cp.nodes, extractScratch);
+    checkpointWriter.submit(config.checkpointPath, cp);
+}
+
+SearchStats SimplePathfinder::currentStats() const {
+    SearchStats s = stats;
+    s.physicsNs = physicsNs.load(std::memory_order_relaxed);
+    s.collideNs = collideNs.load(std::memory_order_relaxed);
+    return s;
+}
+
+// Packs quantized x (24 bits), y (20), velY (12), onGround (1), gravity
+// and size (2) and the mode (3). The previous input only tells states apart
+// in modes that act on presses.
+uint64_t SimplePathfinder::stateKey(float x, float y, float velY, uint32_t flags) {
+    auto q = [](float v, float step, int64_t bias, int bits) {
+        int64_t i = static_cast<int64_t>(std::floor(v / step)) + bias;
+        return static_cast<uint64_t>(std::clamp<int64_t>(i, 0, (int64_t(1) << bits) - 1));
+    };
+    constexpr uint32_t pressModes = 1u << static_cast<int>(Gamemode::Ball)
+                                  | 1u << static_cast<int>(Gamemode::Ufo)
+                                  | 1u << static_cast<int>(Gamemode::Spider)
+                                  | 1u << static_cast<int>(Gamemode::Swing);
+    bool held = (flags & StateFlags::HELD) && ((pressModes >> static_cast<int>(StateFlags::modeOf(flags))) & 1);
+    return q(x, DEDUP_X, 0, 24)
+         | q(y, DEDUP_Y, 1 << 19, 20) << 24
+         | q(velY, DEDUP_VEL, 1 << 11, 12) << 44
+         | static_cast<uint64_t>((flags & StateFlags::GROUND) != 0) << 56
+         | static_cast<uint64_t>(StateFlags::variantOf(flags)) << 57
+         | static_cast<uint64_t>(held) << 62;
+}
+
+// Reorders beam[1..] so states of the same variant are contiguous and the
+// kernels run long branch-free loops. The leader stays first and its
+// variant comes right after it. Single-mode beams are left alone.
+void SimplePathfinder::groupByVariant(BeamSoA& beam, BeamSoA& scratch) {
+    size_t n = beam.size();
+    if (n < 3) return;
+    
+    uint32_t lead = StateFlags::variantOf(beam.flags[0]);
+    bool mixed = false;
+    for (size_t i = 1; i < n && !mixed; i++) mixed = StateFlags::variantOf(beam.flags[i]) != lead;
+    if (!mixed) return;
+    
+    auto bucket = [&](size_t i) {
+        uint32_t v = StateFlags::variantOf(beam.flags[i]);
+        return v == lead ? 0u : v + 1;
+    };
+    std::array<size_t, StateFlags::VARIANTS + 2> start{};
+    for (size_t i = 1; i < n; i++) start[bucket(i) + 1]++;
+    for (size_t b = 1; b < start.size(); b++) start[b] += start[b - 1];
+    
+    scratch.resize(n);
+    scratch.copyFrom(0, beam, 0);
+    for (size_t i = 1; i < n; i++) scratch.copyFrom(1 + start[bucket(i)]++, beam, i);
+    for (size_t i = 1; i < n; i++) beam.copyFrom(i, scratch, i);
+}
+
+// Keeps the `width` highest-scoring entries of `next` in `out`, best first
+void SimplePathfinder::selectBest(const BeamSoA& next, size_t width, BeamSoA& out, std::vector<SelectKey>& keys) {
+    keys.clear();
+    keys.reserve(next.size());
+    for (size_t i = 0; i < next.size(); i++) {
+        keys.push_back({next.score[i], static_cast<uint32_t>(i)});
+    }
+    
+    auto better = [](const SelectKey& a, const SelectKey& b) { return a.score > b.score; };
+    if (keys.size() > width) {
+        std::nth_element(keys.begin(), keys.begin() + width, keys.end(), better);
+        keys.resize(width);
+    }
+    
+    // Only the leader needs to be in order
+    auto best = std::min_element(keys.begin(), keys.end(), better);
+    std::iter_swap(keys.begin(), best);
+    
+    out.resize(keys.size());
+    for (size_t i = 0; i < keys.size(); i++) out.copyFrom(i, next, keys[i].index);
+}
+
+// Bytes of both generation arenas for a beam of `width`: the beam, the
+// next generation and the children (two slots per state each), with their
+// selection keys and dedup entries
+size_t SimplePathfinder::arenaBytes(size_t width) {
+    size_t perState = BeamSoA::BYTES_PER_STATE * 5 + (sizeof(SelectKey) + sizeof(uint64_t) + SEEN_BYTES) * 2;
+    return width * perState;
+}
+
+// Widest beam whose arenas fit in the beam budget and in half the hard
+// cap; the input tree gets the other half
+int SimplePathfinder::maxWidthForBudget() const {
+    size_t budget = static_cast<size_t>(config.memoryBudgetMB) * 1024 * 1024;
+    size_t cap = static_cast<size_t>(config.memoryCapMB) * 1024 * 1024 / 2;
+    size_t width = std::min(budget, cap) / arenaBytes(1);
+    return static_cast<int>(std::clamp<size_t>(width, MIN_WIDTH, INT32_MAX));
+}
+
+// Sizes the arenas once, so generations are recycled without touching the
+// heap, and sets how far the input tree may grow in what the cap leaves
+void SimplePathfinder::reserveArenas(int width, BeamSoA& beam, BeamSoA& next) {
+    int maxWidth = maxWidthForBudget();
+    int reach = config.adaptiveBeam ? std::max(width, config.beamWidth) * ARENA_HEADROOM : width;
+    size_t w = static_cast<size_t>(std::min(reach, maxWidth));
+    
+    beam.reserve(w);
+    next.reserve(w * 2);
+    children.reserve(w * 2);
+    keys.reserve(w * 2);
+    childKeys.reserve(w * 2);
+    seen.reserve(w * 2);
+    treeLimit = treeBudget();
+}
+
+// Nodes the input tree may hold in what the cap leaves after the arenas.
+// Growing the tree briefly holds the old and new buffer, and compacting it
+// needs a 4-byte scratch entry per node, so a node costs 1.5x its size.
+size_t SimplePathfinder::treeBudget() const {
+    size_t cap = static_cast<size_t>(config.memoryCapMB) * 1024 * 1024;
+    size_t maxWidth = static_cast<size_t>(maxWidthForBudget());
+    size_t left = cap - std::min(cap, arenaBytes(maxWidth));
+    return std::max(left / (sizeof(InputTree::Node) * 3 / 2), maxWidth * 4);
+}
+
+// Keeps the best states of `beam` that the tree can still take children
+// for. Returns false if not even a minimal beam fits any more.
+bool SimplePathfinder::shrinkToTree(BeamSoA& beam, BeamSoA& scratch, int& width, int frame) {
+    size_t room = (tree.capacity() - tree.size()) / 2;
+    if (room < MIN_WIDTH) {
+        LOGE("Memory cap of {} MB reached at frame {}", config.memoryCapMB, frame);
+        return false;
+    }
+    
+    selectBest(beam, room, scratch, keys);
+    beam.resize(scratch.size());
+    for (size_t i = 0; i < scratch.size(); i++) beam.copyFrom(i, scratch, i);
+    width = std::min(width, static_cast<int>(room));
+    LOGW("Memory cap: beam narrowed to {} at frame {}", width, frame);
+    return true;
+}
+
+// Makes room for `needed` more tree nodes: the tree grows up to treeLimit,
+// then is compacted to the paths still used by the states `forEachHolder`
+// visits. Returns false if it still doesn't fit.
+template <class F>
+bool SimplePathfinder::makeTreeRoom(size_t needed, F&& forEachHolder) {
+    if (tree.size() + needed <= tree.capacity()) return true;
+    
+    if (tree.capacity() < treeLimit) {
+        tree.reserve(std::min(treeLimit, std::max(tree.capacity() * 2, tree.size() + needed)));
+        if (tree.size() + needed <= tree.capacity()) return true;
+    }
+    
+    compactLeaves.clear();
+    forEachHolder([&](BeamSoA& b) { compactLeaves.insert(compactLeaves.end(), b.node.begin(), b.node.end()); });
+    
+    size_t before = tree.size();
+    tree.compact(compactLeaves, extractScratch);
+    stats.compactions++;
+    
+    size_t i = 0;
+    forEachHolder([&](BeamSoA& b) {
+        std::copy_n(compactLeaves.begin() + i, b.size(), b.node.begin());
+        i += b.size();
+    });
+    LOGI("Compacted input tree from {} to {} nodes", before, tree.size());
+    return tree.size() + needed <= tree.capacity();
+}
+
+// Widens the beam when most children die while there are more survivors
+// than slots, and slowly narrows it back once the level opens up again.
+// Every state of a frame has the same x, short of speed portals, so the
+// survivors' x spread says nothing about how diverse the beam is.
+int SimplePathfinder::adaptWidth(int width, size_t generated, size_t alive, const BeamSoA& next) const {
+    if (!config.adaptiveBeam || next.empty() || generated == 0) return width;
+    
+    float survival = static_cast<float>(alive) / generated;
+    bool crowded = next.size() > static_cast<size_t>(width);
+    
+    int minWidth = std::max(MIN_WIDTH, config.beamWidth / 4);
+    int maxWidth = maxWidthForBudget();
+    
+    if (survival < 0.5f && crowded) {
+        width = static_cast<int>(width * WIDEN);
+    } else if (survival > 0.9f) {
+        width = static_cast<int>(width * NARROW);
+    }
+    return std::clamp(width, std::min(minWidth, maxWidth), maxWidth);
+}
+
+void SimplePathfinder::prepareDangerMap() {
+    if (!config.dangerMap) {
+        danger.clear();
+        return;
+    }
+    if (!danger.empty() && dangerLevelHash == levelHash && danger.tickRate() == tick.rate) return;
+    
+    danger.build(*m_level, MAX_FRAMES, m_level->levelLength + 50, tick, &running);
+    dangerLevelHash = levelHash;
+}
+
+// Simulates the seed from the level start and puts the beam on it
+// SEED_BACKOFF_SECONDS before it dies, enters a doomed cell or runs out,
+// or where it completes the level. The seed's inputs up to there become
+// the only path in the tree. Returns the frame the beam starts at.
+int SimplePathfinder::followSeed(BeamSoA& beam, float levelLen) {
+    const Level& level = *m_level;
+    std::vector<SimState> states(1);
+    states.reserve(std::min<size_t>(seedInputs.size(), MAX_FRAMES) + 1);
+    
+    SimState s;
+    const char* ended = "ran out";
+    size_t limit = std::min<size_t>(seedInputs.size(), MAX_FRAMES - 1);
+    bool won = false;
+    for (size_t f = 0; f < limit; f++) {
+        simulateFrame(s, seedInputs[f], level, tick);
+        if (s.dead) {
+            ended = "died";
+            break;
+        }
+        if (danger.doomed(static_cast<int>(f) + 1, s.y, s.velY, s.onGround)) {
+            ended = "is doomed";
+            break;
+        }
+        states.push_back(s);
+        if (s.x >= levelLen - 50) {
+            ended = "completes the level";
+            won = true;
+            break;
+        }
+    }
+    
+    int followed = static_cast<int>(states.size()) - 1;
+    int backoff = won ? 0 : static_cast<int>(SEED_BACKOFF_SECONDS * tick.rate);
+    int frame = std::max(0, followed - backoff);
+    
+    uint32_t node = InputTree::ROOT;
+    for (int f = 0; f < frame; f++) node = tree.push(node, seedInputs[f]);
+    beam.push(states[frame], node);
+    
+    LOGI("Seed of {} inputs {} after frame {} (x {:.0f}), branching from frame {}",
+         seedInputs.size(), ended, followed, states[followed].x, frame);
+    seedInputs.clear();
+    return frame;
+}
+
+// Refines the found solution for playing while the search can still be
+// stopped; a stop meanwhile publishes it unrefined
+void SimplePathfinder::refineSolution() {
+    refined.clear();
+    if (!config.refine || solution.empty()) return;
+    
+    SolutionRefiner refiner(*m_level, tick, m_level->levelLength + 50, config.refineTicks);
+    std::vector<bool> inputs = solution;
+    if (!refiner.refine(inputs, *pool, refineReport, &running)) return;
+    refined = std::move(inputs);
+    refineReport.log(m_level->levelLength + 100);
+}
+
+// Adopts the newest chunks of a streamed level, first waiting until they
+// cover everything a state at `x` can touch or score against in the next
+// frame. The danger map waits for the whole level, since doom depends on
+// everything ahead. Returns false if the search was stopped meanwhile.
+bool SimplePathfinder::followStream(float x) {
+    float needed = x + scorer.reach();
+    if (m_stream->readyX() < needed) {
+        LOGI("Waiting for level extraction past x {:.0f}", x);
+    }
+    while (running && !m_stream->waitFor(needed, std::chrono::milliseconds(STREAM_POLL_MS))) {
+        if (m_stream->cancelled()) {
+            LOGE("Level extraction was cancelled");
+            return false;
+        }
+    }
+    if (!running) return false;
+    
+    auto latest = m_stream->latest();
+    if (latest != m_level) {
+        m_level = std::move(latest);
+        scorer = StateScorer(*m_level, config.heuristic, tick);
+    }
+    if (m_stream->complete()) {
+        m_stream.reset();
+        levelHash = hashLevel(*m_level);
+        prepareDangerMap();
+        LOGI("Searching the complete level");
+    }
+    return true;
+}
+
+void SimplePathfinder::findPath() {
+    // Only the beam search runs on part of a level; the other searches plan
+    // over all of it up front
+    if (m_stream) {
+        bool whole = config.segmented || config.decisionPoints;
+        danger.clear();
+        if (!followStream(whole ? std::numeric_limits<float>::infinity() : 0)) {
+            m_stream.reset();
+            publish(BeamSoA(), 0, 0, 0, true);
+            running = false;
+            return;
+        }
+    } else {
+        prepareDangerMap();
+    }
+    
+    // Resumed and seeded searches continue as a single beam from where
+    // they pick up
+    bool fresh = !resuming && seedInputs.empty();
+    if (config.segmented && fresh) {
+        findPathSegmented();
+        return;
+    }
+    if (config.decisionPoints && fresh) {
+        findPathDecisions();
+        return;
+    }
+    
+    LOGI("Pathfinder thread started");
+    trackCommitted = true;
+    
+    // Replaced between frames while the level streams in
+    const Level* level = m_level.get();
+    float levelLen = level->levelLength + 100;
+    
+    LOGI("Physics kernel: {}", BatchPhysics::kernelName());
+    
+    // Simple simulation
+    BeamSoA beam;
+    BeamSoA nextBeam;
+    tree.clear();
+    
+    float bestX = 0;
+    int width = std::min(config.beamWidth, maxWidthForBudget());
+    int frame = 0;
+    
+    if (resuming) {
+        auto& cp = checkpointBuf;
+        tree.assign(std::move(cp.nodes));
+        beam = std::move(cp.beam);
+        frame = cp.frame;
+        bestX = cp.bestX;
+        width = std::min(cp.width, maxWidthForBudget());
+        progress = bestX / levelLen;
+        resuming = false;
+        LOGI("Resuming at frame {} with {} states, best x {:.0f}", frame, beam.size(), bestX);
+    } else if (!seedInputs.empty()) {
+        frame = followSeed(beam, levelLen);
+        bestX = beam.x[0];
+        progress = bestX / levelLen;
+    } else {
+        SimState initial;
+        beam.push(initial, InputTree::ROOT);
+    }
+    reserveArenas(width, beam, nextBeam);
+    
+    // A stopped search is always checkpointed; an interval of 0 only
+    // turns off the periodic saves
+    bool checkpointing = !config.checkpointPath.empty();
+    bool periodic = checkpointing && config.checkpointSeconds > 0;
+    auto checkpointInterval = std::chrono::seconds(std::max(1, config.checkpointSeconds));
+    auto nextCheckpoint = Clock::now() + checkpointInterval;
+    bool exhausted = false;
+    
+    size_t capChildren = 0, capNext = 0, capBeam = 0, capKeys = 0, capTree = 0, buckets = 0;
+    
+    for (; frame < MAX_FRAMES && running; frame++) {
+        size_t generated = 0;
+        size_t alive = 0;
+        seen.clear();
+        
+        for (size_t i = 0; i < beam.size(); i++) {
+            if (!beam.dead(i) && beam.x[i] >= levelLen - 50) {
+                solution = tree.rebuild(beam.node[i]);
+                found = true;
+                progress = 1.0f;
+                refineSolution();
+                publish(beam, frame, beam.x[i], width, true);
+                
+                // A solved level has nothing left to resume
+                if (!config.checkpointPath.empty()) {
+                    checkpointWriter.flush();
+                    std::error_code ec;
+                    std::filesystem::remove(config.checkpointPath, ec);
+                }
+                running = false;
+                LOGI("{}", currentStats().logLine(frame));
+                LOGI("Path found! {} inputs", solution.size());
+                return;
+            }
+        }
+        
+        if (m_stream) {
+            if (!followStream(beam.x[0])) break;
+            level = m_level.get();
+        }
+        
+        // Every child may add a tree node
+        if (!makeTreeRoom(beam.size() * 2, [&](auto&& visit) { visit(beam); }) &&
+            !shrinkToTree(beam, nextBeam, width, frame)) {
+            break;
+        }
+        
+        // Every state of a frame shares x, and with it the speed
+        auto frameTick = tick.atSpeed(level->speedAt(beam.x[0]));
+        
+        // Expand in parallel: child 2*i + inp belongs to beam[i], so the
+        // merge below is deterministic regardless of scheduling
+        auto expandStart = Clock::now();
+        children.resize(beam.size() * 2);
+        childKeys.resize(children.size());
+        pool->parallelFor(beam.size(), EXPAND_GRAIN, [&](size_t begin, size_t end) {
+            if (!running) return;
+            for (size_t i = begin; i < end; i++) {
+                for (int inp = 0; inp < 2; inp++) {
+                    size_t c = i * 2 + inp;
+                    children.copyFrom(c, beam, i);
+                    children.flags[c] &= ~StateFlags::CLICK;
+                    if (inp == 1) children.flags[c] |= StateFlags::CLICK;
+                }
+            }
+            
+            // Uniform physics for the whole chunk, then per-state collision
+            auto t0 = Clock::now();
+            size_t c0 = begin * 2, n = (end - begin) * 2;
+            BatchPhysics::step(&children.x[c0], &children.y[c0], &children.velY[c0], &children.flags[c0], n, frameTick);
+            
+            auto t1 = Clock::now();
+            for (size_t c = c0; c < c0 + n; c++) {
+                childKeys[c] = DEAD_KEY;
+                if (children.dead(c)) continue;
+                SimState ns = children.get(c);
+                collide(ns, *level);
+                children.set(c, ns);
+                if (ns.dead) continue;
+                
+                // Doomed children are dropped here, before they cost a score
+                if (danger.doomed(frame + 1, ns.y, ns.velY, ns.onGround)) {
+                    childKeys[c] = DOOMED_KEY;
+                    continue;
+                }
+                children.score[c] = scorer(ns.x, ns.y, ns.velY, children.flags[c]);
+                childKeys[c] = stateKey(ns.x, ns.y, ns.velY, children.flags[c]);
+            }
+            
+            auto t2 = Clock::now();
+            physicsNs.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count(),
+                                std::memory_order_relaxed);
+            collideNs.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(t2 - t1).count(),
+                                std::memory_order_relaxed);
+        });
+        stats.expandNs += nsSince(expandStart);
+        if (!running) break;
+        
+        auto mergeStart = Clock::now();
+        nextBeam.clear();
+        for (size_t c = 0; c < children.size(); c++) {
+            size_t parent = c / 2;
+            if (beam.dead(parent)) continue;
+            generated++;
+            
+            uint64_t key = childKeys[c];
+            if (key == DEAD_KEY) {
+                stats.prunedDead++;
+                continue;
+            }
+            alive++;
+            
+            if (key == DOOMED_KEY) {
+                stats.prunedDoomed++;
+                continue;
+            }
+            
+            // Merge near-identical children before they take a slot
+            if (seen.insert(key)) {
+                nextBeam.pushFrom(children, c, tree.push(beam.node[parent], (c & 1) != 0));
+            } else {
+                stats.prunedDuplicate++;
+            }
+        }
+        stats.expanded += generated;
+        stats.mergeNs += nsSince(mergeStart);
+        
+        if (nextBeam.empty()) {
+            LOGE("All states dead at frame {}", frame);
+            exhausted = true;
+            break;
+        }
+        
+        auto selectStart = Clock::now();
+        width = adaptWidth(width, generated, alive, nextBeam);
+        
+        // Keep the best-scoring states
+        selectBest(nextBeam, width, beam, keys);
+        stats.prunedWidth += nextBeam.size() - beam.size();
+        groupByVariant(beam, nextBeam);
+        stats.selectNs += nsSince(selectStart);
+        
+        trackCapacity(children.x.capacity(), capChildren, stats.allocations);
+        trackCapacity(nextBeam.x.capacity(), capNext, stats.allocations);
+        trackCapacity(beam.x.capacity(), capBeam, stats.allocations);
+        trackCapacity(keys.capacity(), capKeys, stats.allocations);
+        trackCapacity(tree.capacity(), capTree, stats.allocations);
+        trackCapacity(seen.capacity(), buckets, stats.allocations);
+        
+        if (!beam.empty() && beam.x[0] > bestX) {
+            bestX = beam.x[0];
+            progress = bestX / levelLen;
+        }
+        
+        if (frame % PUBLISH_INTERVAL == 0) {
+            publish(beam, frame, bestX, width, false);
+        }
+        
+        // Checkpoints are keyed by the level hash, so only the complete
+        // level is checkpointed
+        if (periodic && !m_stream && Clock::now() >= nextCheckpoint) {
+            checkpoint(beam, frame + 1, bestX, width);
+            nextCheckpoint = Clock::now() + checkpointInterval;
+        }
+        
+        if (frame % 100 == 0) {
+            LOGI("Frame {}, beam size {}/{}, best x {:.0f}", frame, beam.size(), width, bestX);
+        }
+        
+        if (frame % STATS_INTERVAL == 0) {
+            LOGI("{}", currentStats().logLine(frame));
+        }
+    }
+    
+    if (!beam.empty()) solution = tree.rebuild(beam.node[0]);
+    
+    publish(beam, frame, bestX, width, true);
+    
+    // Stopped (or out of frames) with a live beam: save it so the search
+    // can pick up from here. `frame` is the first frame not yet simulated.
+    if (checkpointing && !exhausted && !beam.empty() && !m_stream) {
+        checkpoint(beam, frame, bestX, width);
+        checkpointWriter.flush();
+    }
+    
+    m_stream.reset();
+    running = false;
+    LOGI("{}", currentStats().logLine(frame));
+    LOGI("Pathfinder finished, best progress: {:.1f}%", progress * 100);
+}
+
+// ============================================================================
+// SEGMENTED SEARCH
+// ============================================================================
+
+// True if a player resting on the floor at `x` has had nothing but open
+// ground under and around it for the last LANDMARK_CLEAR units, so a state
+// on the floor there is the same no matter how it got there. Past the first
+// portal the state could be in any mode, so there are no landmarks.
+bool SimplePathfinder::isLandmark(float x) const {
+    if (x < LANDMARK_CLEAR + 12 || x + 12 >= m_level->firstPortalX()) return false;
+    
+    HitRect sweep = {x - LANDMARK_CLEAR - 12, BatchPhysics::GROUND_Y - 12, LANDMARK_CLEAR + 24, 24};
+    bool clear = true;
+    m_level->forEachCandidate(sweep, [&](const LevelObject&) {
+        clear = false;
+        return false;
+    });
+    return clear;
+}
+
+// Horizontal speed doesn't depend on input, so x at every frame is known up
+// front and segment boundaries can be placed by frame, not by position.
+std::vector<SimplePathfinder::Segment> SimplePathfinder::planSegments(const std::vector<float>& xAt,
+                                                                      float levelLen) const {
+    int goal = MAX_FRAMES;
+    for (int f = 0; f <= MAX_FRAMES; f++) {
+        if (xAt[f] >= levelLen - 50) {
+            goal = f;
+            break;
+        }
+    }
+    
+    int wanted = std::clamp(config.threadCount() * SEGMENTS_PER_THREAD, 1, std::max(1, goal / MIN_SEGMENT_FRAMES));
+    
+    // Walk back from each evenly spaced split to the nearest landmark
+    std::vector<Segment> segments;
+    int start = 0;
+    for (int k = 1; k < wanted; k++) {
+        int target = static_cast<int>(static_cast<int64_t>(goal) * k / wanted);
+        for (int f = target; f >= start + MIN_SEGMENT_FRAMES; f--) {
+            if (isLandmark(xAt[f])) {
+                segments.push_back({start, f, false});
+                start = f;
+                break;
+            }
+        }
+    }
+    segments.push_back({start, MAX_FRAMES, true});
+    return segments;
+}
+
+// Runs a serial beam over one segment, starting from a state resting on
+// the floor. `report` is called every PUBLISH_INTERVAL frames.
+template <class F>
+SimplePathfinder::SegmentResult SimplePathfinder::solveSegment(const Segment& seg, const std::vector<float>& xAt,
+                                                               float levelLen, int width,
+                                                               std::atomic<int64_t>& framesDone, F&& report) {
+    const Level& level = *m_level;
+    
+    SegmentResult res;
+    BeamSoA beam, next, kids;
+    InputTree segTree;
+    KeySet segSeen;
+    std::vector<SelectKey> segKeys;
+    
+    SimState entry;
+    entry.x = xAt[seg.startFrame];
+    beam.push(entry, InputTree::ROOT);
+    res.bestX = entry.x;
+    
+    for (int frame = seg.startFrame; frame < MAX_FRAMES && running; frame++) {
+        if (seg.last) {
+            for (size_t i = 0; i < beam.size(); i++) {
+                if (!beam.dead(i) && beam.x[i] >= levelLen - 50) {
+                    res.solved = true;
+                    res.inputs = segTree.rebuild(beam.node[i]);
+                    return res;
+                }
+            }
+        }
+        
+        kids.resize(beam.size() * 2);
+        for (size_t i = 0; i < beam.size(); i++) {
+            for (int inp = 0; inp < 2; inp++) {
+                size_t c = i * 2 + inp;
+                kids.copyFrom(c, beam, i);
+                kids.flags[c] &= ~StateFlags::CLICK;
+                if (inp == 1) kids.flags[c] |= StateFlags::CLICK;
+            }
+        }
+        BatchPhysics::step(kids.x.data(), kids.y.data(), kids.velY.data(), kids.flags.data(), kids.size(),
+                           tick.atSpeed(level.speedAt(beam.x[0])));
+        
+        next.clear();
+        segSeen.clear();
+        for (size_t c = 0; c < kids.size(); c++) {
+            if (beam.dead(c / 2)) continue;
+            res.stats.expanded++;
+            
+            if (!kids.dead(c)) {
+                SimState ns = kids.get(c);
+                collide(ns, level);
+                kids.set(c, ns);
+                if (!ns.dead) kids.score[c] = scorer(ns.x, ns.y, ns.velY, kids.flags[c]);
+            }
+            if (kids.dead(c)) {
+                res.stats.prunedDead++;
+                continue;
+            }
+            if (danger.doomed(frame + 1, kids.y[c], kids.velY[c], (kids.flags[c] & StateFlags::GROUND) != 0)) {
+                res.stats.prunedDoomed++;
+                continue;
+            }
+            
+            uint64_t key = stateKey(kids.x[c], kids.y[c], kids.velY[c], kids.flags[c]);
+            if (segSeen.insert(key)) {
+                next.pushFrom(kids, c, segTree.push(beam.node[c / 2], (c & 1) != 0));
+            } else {
+                res.stats.prunedDuplicate++;
+            }
+        }
+        
+        if (next.empty()) {
+            res.died = true;
+            return res;
+        }
+        
+        // Hand over at the landmark only from the canonical resting state,
+        // so the next segment's start is exactly what this one produced
+        if (!seg.last && frame + 1 == seg.endFrame) {
+            for (size_t i = 0; i < next.size(); i++) {
+                if ((next.flags[i] & StateFlags::GROUND) && next.y[i] == BatchPhysics::GROUND_Y && next.velY[i] == 0) {
+                    res.solved = true;
+                    res.inputs = segTree.rebuild(next.node[i]);
+                    break;
+                }
+            }
+            res.bestX = next.x[0];
+            return res;
+        }
+        
+        selectBest(next, width, beam, segKeys);
+        res.stats.prunedWidth += next.size() - beam.size();
+        res.bestX = beam.x[0];
+        
+        framesDone.fetch_add(1, std::memory_order_relaxed);
+        if (frame % PUBLISH_INTERVAL == 0) report();
+    }
+    return res;
+}
+
+void SimplePathfinder::findPathSegmented() {
+    LOGI("Pathfinder thread started (segmented)");
+    
+    const Level& level = *m_level;
+    float levelLen = level.levelLength + 100;
+    
+    std::vector<float> xAt(MAX_FRAMES + 1);
+    for (int f = 0; f < MAX_FRAMES; f++) xAt[f + 1] = xAt[f] + tick.xStep * level.speedAt(xAt[f]);
+    
+    auto segments = planSegments(xAt, levelLen);
+    int goalFrames = 0;
+    for (auto& seg : segments) {
+        if (!seg.last) goalFrames = seg.endFrame;
+    }
+    goalFrames = std::max(goalFrames, static_cast<int>(std::lower_bound(xAt.begin(), xAt.end(), levelLen - 50) - xAt.begin()));
+    
+    // Every segment holds its own beam at the same time
+    int width = std::max(MIN_WIDTH, std::min(config.beamWidth, maxWidthForBudget() / pool->size()));
+    LOGI("Split level into {} segments, width {} each", segments.size(), width);
+    
+    // Only the search thread may publish; it runs segments like any other
+    // participant and reports progress for all of them while it does
+    std::atomic<int64_t> framesDone{0};
+    auto searchThread = std::this_thread::get_id();
+    BeamSoA noBeam;
+    float bestX = 0;
+    auto report = [&]() {
+        if (std::this_thread::get_id() != searchThread) return;
+        int64_t done = framesDone.load(std::memory_order_relaxed);
+        progress = std::min(0.99f, static_cast<float>(done) / goalFrames);
+        publish(noBeam, static_cast<int>(done), bestX, width, false);
+    };
+    
+    std::vector<SegmentResult> results(segments.size());
+    pool->parallelFor(segments.size(), 1, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            results[i] = solveSegment(segments[i], xAt, levelLen, width, framesDone, report);
+        }
+    });
+    
+    // Stitch left to right. A segment that can't hand over at its landmark
+    // absorbs the next one, and one whose landmark start is a dead end is
+    // absorbed by the previous one; the merged segment is solved again.
+    size_t i = 0;
+    while (running && i < segments.size()) {
+        auto& r = results[i];
+        if (r.solved) {
+            i++;
+            continue;
+        }
+        
+        if (r.died && i > 0) {
+            segments[i - 1].endFrame = segments[i].endFrame;
+            segments[i - 1].last = segments[i].last;
+            segments.erase(segments.begin() + i);
+            results.erase(results.begin() + i);
+            i--;
+        } else if (!r.died && !segments[i].last) {
+            segments[i].endFrame = segments[i + 1].endFrame;
+            segments[i].last = segments[i + 1].last;
+            segments.erase(segments.begin() + i + 1);
+            results.erase(results.begin() + i + 1);
+        } else {
+            break;
+        }
+        
+        LOGI("Merged segments at frame {}, {} left", segments[i].startFrame, segments.size());
+        results[i] = solveSegment(segments[i], xAt, levelLen, width, framesDone, report);
+    }
+    
+    std::vector<bool> inputs;
+    bool solved = running;
+    for (auto& r : results) {
+        stats.expanded += r.stats.expanded;
+        stats.prunedDead += r.stats.prunedDead;
+        stats.prunedDuplicate += r.stats.prunedDuplicate;
+        stats.prunedWidth += r.stats.prunedWidth;
+        stats.prunedDoomed += r.stats.prunedDoomed;
+        
+        if (!solved) continue;
+        if (!r.solved) {
+            solved = false;
+            bestX = std::max(bestX, r.bestX);
+            continue;
+        }
+        inputs.insert(inputs.end(), r.inputs.begin(), r.inputs.end());
+        bestX = xAt[std::min<size_t>(inputs.size(), MAX_FRAMES)];
+    }
+    
+    // Replay the stitched inputs once to make sure the seams hold
+    if (solved) {
+        SimState check;
+        for (bool click : inputs) {
+            simulateFrame(check, click, level, tick);
+            if (check.dead) break;
+        }
+        if (check.dead || check.x < levelLen - 50) {
+            LOGE("Stitched path fails at x {:.0f}", check.x);
+            solved = false;
+        }
+    }
+    
+    solution = std::move(inputs);
+    found = solved;
+    progress = solved ? 1.0f : std::min(1.0f, bestX / levelLen);
+    if (solved) refineSolution();
+    publish(noBeam, static_cast<int>(solution.size()), bestX, width, true);
+    running = false;
+    
+    LOGI("{}", currentStats().logLine(static_cast<int>(solution.size())));
+    if (solved) {
+        LOGI("Path found! {} inputs from {} segments", solution.size(), segments.size());
+    } else {
+        LOGI("Pathfinder finished, best progress: {:.1f}%", progress * 100);
+    }
+}
+
+// ============================================================================
+// DECISION POINT SEARCH
+// ============================================================================
+
+// Simulates child `c`, which starts at `frame`, until input matters again
+// (BatchPhysics::decides), it dies, reaches `goalX` or has flown
+// FLIGHT_FRAMES. Modes that steer in the air decide on every frame.
+// Returns the frame it stopped at; `doomed` is set if the danger map
+// killed it on the way.
+int SimplePathfinder::flyToDecision(BeamSoA& kids, size_t c, int frame, float goalX, bool& doomed) const {
+    const Level& level = *m_level;
+    SimState s = kids.get(c);
+    bool click = (kids.flags[c] & StateFlags::CLICK) != 0;
+    int end = std::min(frame + FLIGHT_FRAMES, MAX_FRAMES);
+    
+    doomed = false;
+    do {
+        simulateFrame(s, click, level, tick);
+        click = false;
+        frame++;
+        if (s.dead) break;
+        if (s.x >= goalX) {
+            s.won = true;
+            break;
+        }
+        if (danger.doomed(frame, s.y, s.velY, s.onGround)) {
+            doomed = true;
+            break;
+        }
+    } while (!BatchPhysics::decides(s.mode, s.onGround) && frame < end);
+    
+    kids.set(c, s);
+    if (!s.dead && !doomed) kids.score[c] = scorer(s.x, s.y, s.velY, kids.flags[c]);
+    return frame;
+}
+
+// States no longer share a frame: each waits in the slot of the frame it
+// next gets to choose at, and only states whose input matters branch. A
+// cube jump costs one node for its whole flight instead of one per frame.
+void SimplePathfinder::findPathDecisions() {
+    LOGI("Pathfinder thread started (decision points)");
+    trackCommitted = false;
+    
+    const Level& level = *m_level;
+    float levelLen = level.levelLength + 100;
+    float goalX = levelLen - 50;
+    
+    // Indexed by frame modulo the ring size; no flight outruns the ring
+    std::vector<BeamSoA> waiting(FLIGHT_FRAMES + 1);
+    std::vector<KeySet> waitingSeen(waiting.size());
+    size_t waitingStates = 1;
+    waiting[0].push(SimState{}, InputTree::ROOT);
+    
+    BeamSoA beam, scratch;
+    std::vector<int> arrival;
+    tree.clear();
+    treeLimit = treeBudget();
+    
+    constexpr int NO_CHILD = -1;
+    constexpr int DOOMED = -2;
+    
+    float bestX = 0;
+    int width = std::min(config.beamWidth, maxWidthForBudget());
+    int frame = 0;
+    
+    for (; frame < MAX_FRAMES && running && waitingStates > 0; frame++) {
+        size_t slot = frame % waiting.size();
+        BeamSoA& due = waiting[slot];
+        
+        if (!due.empty()) {
+            auto selectStart = Clock::now();
+            waitingStates -= due.size();
+            selectBest(due, width, beam, keys);
+            stats.prunedWidth += due.size() - beam.size();
+            due.clear();
+            waitingSeen[slot].clear();
+            stats.selectNs += nsSince(selectStart);
+            
+            auto holders = [&](auto&& visit) {
+                visit(beam);
+                for (auto& b : waiting) visit(b);
+            };
+            if (!makeTreeRoom(beam.size() * 2, holders) && !shrinkToTree(beam, scratch, width, frame)) {
+                break;
+            }
+            
+            // A state left airborne by a capped flight can't act, so it
+            // only gets the released child
+            auto expandStart = Clock::now();
+            children.resize(beam.size() * 2);
+            arrival.resize(children.size());
+            pool->parallelFor(beam.size(), EXPAND_GRAIN, [&](size_t begin, size_t end) {
+                if (!running) return;
+                auto t0 = Clock::now();
+                for (size_t i = begin; i < end; i++) {
+                    for (int inp = 0; inp < 2; inp++) {
+                        size_t c = i * 2 + inp;
+                        children.copyFrom(c, beam, i);
+                        children.flags[c] &= ~StateFlags::CLICK;
+                        if (inp == 1) {
+                            if (!BatchPhysics::decides(children.flags[c])) {
+                                arrival[c] = NO_CHILD;
+                                continue;
+                            }
+                            children.flags[c] |= StateFlags::CLICK;
+                        }
+                        bool doomed;
+                        int at = flyToDecision(children, c, frame, goalX, doomed);
+                        arrival[c] = doomed ? DOOMED : at;
+                    }
+                }
+                physicsNs.fetch_add(nsSince(t0), std::memory_order_relaxed);
+            });
+            stats.expandNs += nsSince(expandStart);
+            if (!running) break;
+            
+            auto mergeStart = Clock::now();
+            for (size_t c = 0; c < children.size(); c++) {
+                int at = arrival[c];
+                if (at == NO_CHILD) continue;
+                stats.expanded++;
+                
+                if (at == DOOMED) {
+                    stats.prunedDoomed++;
+                    continue;
+                }
+                if (children.dead(c)) {
+                    stats.prunedDead++;
+                    continue;
+                }
+                
+                uint32_t parent = beam.node[c / 2];
+                uint16_t frames = static_cast<uint16_t>(at - frame);
+                if (children.flags[c] & StateFlags::WON) {
+                    solution = tree.rebuild(tree.push(parent, (c & 1) != 0, frames));
+                    found = true;
+                    progress = 1.0f;
+                    refineSolution();
+                    publish(beam, at, children.x[c], width, true);
+                    running = false;
+                    LOGI("{}", currentStats().logLine(at));
+                    LOGI("Path found! {} inputs, {} nodes", solution.size(), tree.size());
+                    return;
+                }
+                
+                // States due at the same frame are merged like in the
+                // frame-by-frame search
+                size_t target = at % waiting.size();
+                uint64_t key = stateKey(children.x[c], children.y[c], children.velY[c], children.flags[c]);
+                if (waitingSeen[target].insert(key)) {
+                    waiting[target].pushFrom(children, c, tree.push(parent, (c & 1) != 0, frames));
+                    waitingStates++;
+                    if (children.x[c] > bestX) {
+                        bestX = children.x[c];
+                        progress = bestX / levelLen;
+                    }
+                } else {
+                    stats.prunedDuplicate++;
+                }
+            }
+            stats.mergeNs += nsSince(mergeStart);
+        }
+        
+        if (frame % PUBLISH_INTERVAL == 0) {
+            publish(beam, frame, bestX, width, false);
+        }
+        
+        if (frame % 100 == 0) {
+            LOGI("Frame {}, {} states waiting, {} nodes, best x {:.0f}", frame, waitingStates, tree.size(), bestX);
+        }
+        
+        if (frame % STATS_INTERVAL == 0) {
+            LOGI("{}", currentStats().logLine(frame));
+        }
+    }
+    
+    if (running && waitingStates == 0) {
+        LOGE("All states dead at frame {}", frame);
+    }
+    
+    if (!beam.empty()) solution = tree.rebuild(beam.node[0]);
+    
+    publish(beam, frame, bestX, width, true);
+    running = false;
+    LOGI("{}", currentStats().logLine(frame));
+    LOGI("Pathfinder finished, best progress: {:.1f}%", progress * 100);
+}
+
+// Hazards kill; solids catch the player on whichever side gravity pulls
+// it towards
+template <bool Flipped>
+static void collideObjects(SimState& s, const Level& level, float half) {
+    HitRect player = {s.x - half, s.y - half, half * 2, half * 2};
+    
+    level.forEachCandidateAt(player, s.x, [&](const LevelObject& obj) {
+        if (obj.isHazard) {
+            s.dead = true;
+            return false;
+        }
+        
+        if (obj.isSolid) {
+            // Simple collision resolution
+            HitRect objRect = obj.rect();
+            if constexpr (!Flipped) {
+                float overlapY = (player.y + player.h) - objRect.y;
+                if (overlapY > 0 && overlapY < 20 && s.velY <= 0) {
+                    s.y = objRect.y + objRect.h + half;
+                    s.velY = 0;
+                    s.onGround = true;
+                }
+            } else {
+                float overlapY = (objRect.y + objRect.h) - player.y;
+                if (overlapY > 0 && overlapY < 20 && s.velY >= 0) {
+                    s.y = objRect.y - half;
+                    s.velY = 0;
+                    s.onGround = true;
+                }
+            }
+        }
+        return true;
+    });
+}
+
+void SimplePathfinder::simulateFrame(SimState& s, bool click, const Level& level, const BatchPhysics::Tick& tick) {
+    uint32_t flags = (s.onGround ? StateFlags::GROUND : 0) | (click ? StateFlags::CLICK : 0);
+    
+    // Levels without portals only ever hold plain cubes, which skip the
+    // dispatch since the scorer runs this for every lookahead frame
+    if (level.portals.empty() && level.speedChanges.empty() && s.mode == Gamemode::Cube && !s.flipped && !s.mini) {
+        BatchPhysics::stepVariant<0>(s.x, s.y, s.velY, flags, tick);
+        s.onGround = (flags & StateFlags::GROUND) != 0;
+        s.held = click;
+        collideObjects<false>(s, level, 12);
+    } else {
+        flags |= (s.held ? StateFlags::HELD : 0)
+               | (s.flipped ? StateFlags::FLIPPED : 0)
+               | (s.mini ? StateFlags::MINI : 0)
+               | static_cast<uint32_t>(s.mode) << StateFlags::MODE_SHIFT;
+        BatchPhysics::stepOne(s.x, s.y, s.velY, flags, tick.atSpeed(level.speedAt(s.x)));
+        
+        // A step only changes ground, gravity and the held input
+        s.onGround = (flags & StateFlags::GROUND) != 0;
+        s.flipped = (flags & StateFlags::FLIPPED) != 0;
+        s.held = click;
+        collide(s, level);
+    }
+    if (s.dead) return;
+    
+    s.frame++;
+}
+
+void SimplePathfinder::collide(SimState& s, const Level& level) {
+    float half = s.mini ? 12 * Physics::MINI_SCALE : 12;
+    
+    // Portals first, so blocks are resolved for the new gravity
+    if (!level.portals.empty()) {
+        HitRect player = {s.x - half, s.y - half, half * 2, half * 2};
+        level.forEachPortal(player, [&](const LevelObject& obj) {
+            if (isModePortal(obj.portal)) {
+                s.mode = portalMode(obj.portal);
+            } else if (obj.portal == Portal::GravityDown || obj.portal == Portal::GravityUp) {
+                s.flipped = obj.portal == Portal::GravityUp;
+            } else if (obj.portal == Portal::SizeNormal || obj.portal == Portal::SizeMini) {
+                s.mini = obj.portal == Portal::SizeMini;
+            }
+        });
+        half = s.mini ? 12 * Physics::MINI_SCALE : 12;
+    }
+    
+    if (s.flipped) {
+        collideObjects<true>(s, level, half);
+    } else {
+        collideObjects<false>(s, level, half);
+    }
+}
@@ -0,0 +1,363 @@
+#pragma once
+
+#include "BatchPhysics.hpp"
+#include "BeamSoA.hpp"
+#include "Checkpoint.hpp"
+#include "DangerMap.hpp"
+#include "Heuristic.hpp"
+#include "InputTree.hpp"
+#include "KeySet.hpp"
+#include "Level.hpp"
+#include "LevelStream.hpp"
+#include "Physics.hpp"
+#include "Refiner.hpp"
+#include "SearchStats.hpp"
+#include "ThreadPool.hpp"
+#include "TripleBuffer.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// ============================================================================
+// SEARCH SNAPSHOT
+// ============================================================================
+
+struct SearchSnapshot {
+    uint32_t run = 0;           // increments with every start()
+    uint32_t version = 0;       // increments with every publish
+    int frame = 0;
+    float bestX = 0;
+    float progress = 0;
+    size_t beamSize = 0;
+    int width = 0;
+    size_t nodes = 0;
+    SearchStats stats;
+    int tickRate = Physics::TICK_RATE;
+    bool finished = false;
+    bool found = false;
+    
+    // Inputs of the current leader, one per tick. The first `committed`
+    // entries are shared by every state in the beam, so they can no longer
+    // change this run.
+    std::vector<bool> prefix;
+    size_t committed = 0;
+    
+    // The found solution after refinement, which is what gets played;
+    // empty if it wasn't refined. `margin` is the fewest ticks any of its
+    // presses can move either way, -1 without refinement.
+    std::vector<bool> refined;
+    int margin = -1;
+    
+    const std::vector<bool>& solution() const {
+        return refined.empty() ? prefix : refined;
+    }
+};
+
+// ============================================================================
+// SEARCH CONFIG
+// ============================================================================
+
+struct SearchConfig {
+    int beamWidth = 3000;
+    bool adaptiveBeam = true;
+    int memoryBudgetMB = 256;
+    
+    // Hard limit on search memory, generation arenas and input tree
+    // together. The tree is compacted and the beam narrowed to stay below.
+    int memoryCapMB = 1024;
+    int workerThreads = 0;
+    
+    // Simulation ticks per second. Solutions only replay correctly at the
+    // rate they were found at; coarser rates search faster.
+    int tickRate = Physics::TICK_RATE;
+    
+    // Where the beam is checkpointed while searching and when stopped;
+    // empty disables it. 0 seconds only checkpoints when stopped.
+    std::filesystem::path checkpointPath;
+    int checkpointSeconds = 60;
+    
+    // Split the level at flat ground stretches and solve the pieces on
+    // separate threads instead of running one beam over the whole level
+    bool segmented = false;
+    
+    // Only branch where a click can change anything (the player is on the
+    // ground) and jump straight over the frames in between
+    bool decisionPoints = false;
+    
+    HeuristicConfig heuristic;
+    
+    // Drop states the precomputed danger map knows are doomed
+    bool dangerMap = true;
+    
+    // Once solved, drop presses the solution doesn't need and move the
+    // rest to the middle of their working timing windows, searched this
+    // many ticks either way
+    bool refine = true;
+    int refineTicks = 3;
+    
+    // 0 means one thread per hardware core
+    int threadCount() const {
+        if (workerThreads > 0) return workerThreads;
+        return std::max(1u, std::thread::hardware_concurrency());
+    }
+};
+
+// ============================================================================
+// SIMPLE PATHFINDER
+// ============================================================================
+
+// Progress leaves the search only through the snapshot triple buffer, so
+// the UI never locks or waits on the search thread. Stopping is
+// cooperative: the search checks for it at least once per expansion
+// chunk, danger map slice and streamed chunk wait, so requestStop() takes
+// effect within milliseconds and stop() never blocks for long.
+class SimplePathfinder {
+public:
+    using StoppedFn = std::function<void()>;
+    
+    static SimplePathfinder& get() {
+        static SimplePathfinder instance;
+        return instance;
+    }
+    
+    ~SimplePathfinder() {
+        stop();
+    }
+    
+    // Searches `level` on a background thread. With `resume`, the search
+    // continues from the checkpoint at cfg.checkpointPath instead of the
+    // level start. Returns false if the search couldn't be started.
+    bool start(std::shared_ptr<const Level> level, const SearchConfig& cfg, bool resume = false);
+    
+    // Searches `level` along `seed` first: the inputs of an earlier
+    // solution or a recorded attempt, one per tick at cfg.tickRate. The
+    // seed is simulated from the level start until it dies or runs out,
+    // and the beam only branches from shortly before that, so re-solving
+    // after a small level edit skips everything the edit didn't touch.
+    bool start(std::shared_ptr<const Level> level, const SearchConfig& cfg, std::vector<bool> seed);
+    
+    // Searches a level that is still being extracted. The beam search runs
+    // on the chunks built so far and only waits when it catches up with
+    // the stream; segmented and decision point searches wait for all of it.
+    bool start(std::shared_ptr<LevelStream> stream, const SearchConfig& cfg);
+    
+    // Searches `level` on the calling thread and returns once done
+    bool run(std::shared_ptr<const Level> level, const SearchConfig& cfg, bool resume = false);
+    bool run(std::shared_ptr<const Level> level, const SearchConfig& cfg, std::vector<bool> seed);
+    
+    // Asks the search to stop and returns right away. `onStopped` is
+    // called once the search has published its final snapshot, from the
+    // search thread, or right here if no search is active.
+    void requestStop(StoppedFn onStopped = {});
+    
+    // Stops the search and waits for it; headless callers and shutdown
+    void stop();
+    
+    // Blocks until a background search has finished on its own
+    void wait();
+    
+    // True from start() until the search has wound down, including after
+    // a stop request. A new search can only start once this is false.
+    bool busy() const {
+        return active.load(std::memory_order_acquire);
+    }
+    
+    bool stopping() const {
+        return busy() && !running.load(std::memory_order_relaxed);
+    }
+    
+    // Latest progress published by the search. Consumer thread only.
+    const SearchSnapshot& latest() {
+        return snapshots.read();
+    }
+    
+    // Reference single-state step; the search uses the batched kernel
+    static void simulateFrame(SimState& s, bool click, const Level& level,
+                              const BatchPhysics::Tick& tick = BatchPhysics::DEFAULT_TICK);
+
+private:
+    // Frames between progress snapshots and between stats log lines
+    static constexpr int PUBLISH_INTERVAL = 60;
+    static constexpr int STATS_INTERVAL = 1000;
+    
+    // Adaptive beam bounds relative to the configured width
+    static constexpr int MIN_WIDTH = 100;
+    static constexpr float WIDEN = 1.5f;
+    static constexpr float NARROW = 0.95f;
+    
+    // Dedup grid: states falling in the same cell are treated as identical
+    static constexpr float DEDUP_X = 0.25f;
+    static constexpr float DEDUP_Y = 0.5f;
+    static constexpr float DEDUP_VEL = 0.1f;
+    
+    // Beam states handed to a worker at a time
+    static constexpr size_t EXPAND_GRAIN = 64;
+    
+    // Generation arenas are preallocated for this multiple of the
+    // configured width when the beam may widen
+    static constexpr int ARENA_HEADROOM = 2;
+    
+    // Heap cost of one dedup entry: a table slot kept at most half full,
+    // in a table sized to a power of two
+    static constexpr size_t SEEN_BYTES = 32;
+    
+    // Child keys that never reach the dedup set; stateKey() leaves the top
+    // bit clear
+    static constexpr uint64_t DEAD_KEY = ~uint64_t(0);
+    static constexpr uint64_t DOOMED_KEY = DEAD_KEY - 1;
+    
+    static constexpr int MAX_FRAMES = 50000;
+    
+    // How often a search waiting on a streamed level checks for stop()
+    static constexpr int STREAM_POLL_MS = 20;
+    
+    // Segmented search: a landmark needs this much object-free run-up
+    // before it, and segments are kept at least this many frames long
+    static constexpr float LANDMARK_CLEAR = Physics::BLOCK;
+    static constexpr int MIN_SEGMENT_FRAMES = 2000;
+    static constexpr int SEGMENTS_PER_THREAD = 2;
+    
+    // Decision point search: longest flight simulated in one go. A state
+    // still airborne after it waits again with a single child.
+    static constexpr int FLIGHT_FRAMES = 512;
+    
+    // A seeded search branches this long before the point where the seed
+    // stops working, so the beam has room to avoid whatever ended it
+    static constexpr float SEED_BACKOFF_SECONDS = 0.5f;
+    
+    struct SelectKey {
+        float score;
+        uint32_t index;
+    };
+    
+    // Frames [startFrame, endFrame) of the level. Every segment but the
+    // last must end resting on the ground at endFrame, which is exactly the
+    // state the next one starts from.
+    struct Segment {
+        int startFrame;
+        int endFrame;
+        bool last;
+    };
+    
+    struct SegmentResult {
+        bool solved = false;
+        bool died = false;
+        float bestX = 0;
+        std::vector<bool> inputs;
+        SearchStats stats;
+    };
+    
+    // Cleared to stop the search; polled by the search and its workers
+    std::atomic<bool> running{false};
+    std::atomic<bool> active{false};
+    std::thread worker;
+    
+    // Stop callbacks waiting for the search to wind down. Only stop
+    // requests and the end of a search take the lock.
+    std::mutex stopMtx;
+    std::vector<StoppedFn> onStopped;
+    
+    // Search thread only; the UI sees them through the snapshot
+    bool found = false;
+    float progress = 0;
+    std::vector<bool> solution;
+    
+    SearchConfig config;
+    BatchPhysics::Tick tick = BatchPhysics::DEFAULT_TICK;
+    std::shared_ptr<const Level> m_level;
+    
+    // Level still being extracted, until its last chunk is adopted
+    std::shared_ptr<LevelStream> m_stream;
+    std::unique_ptr<ThreadPool> pool;
+    InputTree tree;
+    KeySet seen;
+    std::vector<SelectKey> keys;
+    BeamSoA children;
+    
+    // Dedup key of every child, or why it was dropped; filled by the
+    // workers so the serial merge only inserts and copies
+    std::vector<uint64_t> childKeys;
+    StateScorer scorer;
+    
+    // Built once per level, on the search thread
+    DangerMap danger;
+    uint64_t dangerLevelHash = 0;
+    
+    TripleBuffer<SearchSnapshot> snapshots;
+    uint32_t runId = 0;
+    uint32_t version = 0;
+    
+    // Written by the search thread only, except the two worker-side timers
+    SearchStats stats;
+    std::atomic<uint64_t> physicsNs{0};
+    std::atomic<uint64_t> collideNs{0};
+    size_t lastCommitted = 0;
+    std::vector<uint32_t> ancestorScratch;
+    
+    // The committed prefix needs every path at the same depth, which only
+    // holds while each node covers one frame
+    bool trackCommitted = true;
+    
+    // Checkpoint being filled by the search thread, or loaded for resuming
+    Checkpoint checkpointBuf;
+    bool resuming = false;
+    uint64_t levelHash = 0;
+    std::vector<uint32_t> extractScratch;
+    CheckpointWriter checkpointWriter;
+    
+    // Inputs the next beam search follows before branching
+    std::vector<bool> seedInputs;
+    
+    // Refined copy of `solution`, published next to it
+    std::vector<bool> refined;
+    RefineReport refineReport;
+    
+    // Most nodes the input tree may hold under the memory cap
+    size_t treeLimit = 0;
+    std::vector<uint32_t> compactLeaves;
+    
+    bool prepare(std::shared_ptr<const Level> level, const SearchConfig& cfg, bool resume,
+                 std::vector<bool> seed = {});
+    void checkpoint(const BeamSoA& beam, int frame, float bestX, int width);
+    void publish(const BeamSoA& beam, int frame, float bestX, int width, bool finished);
+    SearchStats currentStats() const;
+    
+    static uint64_t stateKey(float x, float y, float velY, uint32_t flags);
+    static void groupByVariant(BeamSoA& beam, BeamSoA& scratch);
+    static void selectBest(const BeamSoA& next, size_t width, BeamSoA& out, std::vector<SelectKey>& keys);
+    static size_t arenaBytes(size_t width);
+    int maxWidthForBudget() const;
+    void reserveArenas(int width, BeamSoA& beam, BeamSoA& next);
+    size_t treeBudget() const;
+    bool shrinkToTree(BeamSoA& beam, BeamSoA& scratch, int& width, int frame);
+    template <class F>
+    bool makeTreeRoom(size_t needed, F&& forEachHolder);
+    int adaptWidth(int width, size_t generated, size_t alive, const BeamSoA& next) const;
+    
+    void prepareDangerMap();
+    void refineSolution();
+    int followSeed(BeamSoA& beam, float levelLen);
+    bool followStream(float x);
+    void runSearch();
+    void findPath();
+    
+    bool isLandmark(float x) const;
+    std::vector<Segment> planSegments(const std::vector<float>& xAt, float levelLen) const;
+    template <class F>
+    SegmentResult solveSegment(const Segment& seg, const std::vector<float>& xAt, float levelLen,
+                               int width, std::atomic<int64_t>& framesDone, F&& report);
+    void findPathSegmented();
+    
+    int flyToDecision(BeamSoA& kids, size_t c, int frame, float goalX, bool& doomed) const;
+    void findPathDecisions();
+    
+    static void collide(SimState& s, const Level& level);
+};
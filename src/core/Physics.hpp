@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstdint>
+
+// ============================================================================
+// PHYSICS CONSTANTS
+// ============================================================================
+
+namespace Physics {
+    constexpr float BLOCK = 30.0f;
+    constexpr float GRAVITY = 0.958199f;
+    constexpr float JUMP_VEL = 11.180032f;
+    
+    // Like every velocity here, in units per 1/60 s
+    constexpr float XVEL = 5.770002f;
+    
+    // Physics steps per second in the game itself
+    constexpr int TICK_RATE = 240;
+    
+    // Speed portal multipliers on XVEL, slowest first
+    constexpr float SPEEDS[] = {0.807f, 1.0f, 1.243f, 1.502f, 1.849f};
+    
+    // Hitbox scale of a mini player
+    constexpr float MINI_SCALE = 0.6f;
+    
+    // Bump whenever the simulation changes, since inputs recorded under
+    // one version don't replay the same under another
+    constexpr uint32_t VERSION = 3;
+}
+
+// ============================================================================
+// GAMEMODE
+// ============================================================================
+
+// Values are packed into three state flag bits, so there can be at most 8
+enum class Gamemode : uint8_t {
+    Cube, Ship, Ball, Ufo, Wave, Robot, Spider, Swing,
+};
+constexpr int GAMEMODE_COUNT = 8;
+
+inline const char* gamemodeName(Gamemode m) {
+    static constexpr const char* names[GAMEMODE_COUNT] = {
+        "cube", "ship", "ball", "ufo", "wave", "robot", "spider", "swing",
+    };
+    return names[static_cast<int>(m)];
+}
+
+// ============================================================================
+// SIMPLE RECT
+// ============================================================================
+
+struct HitRect {
+    float x, y, w, h;
+    
+    bool intersects(const HitRect& o) const {
+        return !((x + w) <= o.x || (o.x + o.w) <= x ||
+                 (y + h) <= o.y || (o.y + o.h) <= y);
+    }
+};
+
+// ============================================================================
+// PLAYER SIM STATE
+// ============================================================================
+
+struct SimState {
+    float x = 0, y = 105;
+    float velY = 0;
+    Gamemode mode = Gamemode::Cube;
+    bool flipped = false;   // gravity points up
+    bool mini = false;
+    bool held = false;      // input of the previous frame
+    bool onGround = true;
+    bool dead = false;
+    bool won = false;
+    int frame = 0;
+};
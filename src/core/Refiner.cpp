@@ -0,0 +1,218 @@
+#include "Refiner.hpp"
+
+#include "Log.hpp"
+#include "Pathfinder.hpp"
+#include "ThreadPool.hpp"
+
+#include <chrono>
+
+using Clock = std::chrono::steady_clock;
+
+// Tight presses listed by RefineReport::log()
+static constexpr size_t TIGHT_SHOWN = 8;
+
+// Two states that will behave the same from here on with the same inputs
+static bool sameState(const SimState& a, const SimState& b) {
+    return a.x == b.x && a.y == b.y && a.velY == b.velY && a.mode == b.mode && a.flipped == b.flipped &&
+           a.mini == b.mini && a.held == b.held && a.onGround == b.onGround;
+}
+
+int RefineReport::minMargin() const {
+    int worst = range;
+    for (auto& p : presses) worst = std::min(worst, p.margin());
+    return worst;
+}
+
+size_t RefineReport::framePerfect() const {
+    return std::count_if(presses.begin(), presses.end(), [](auto& p) { return p.margin() == 0; });
+}
+
+void RefineReport::log(float levelLen) const {
+    LOGI("Refined solution in {:.2f}s ({} sims): {} presses, {} removed, {} moved, "
+         "worst margin {} of {} ticks, {} frame-perfect",
+         seconds, sims, pressesBefore, removed, moved, minMargin(), range, framePerfect());
+    
+    // Tightest first, then in level order
+    std::vector<const PressMargin*> tight;
+    for (auto& p : presses) {
+        if (p.margin() < range) tight.push_back(&p);
+    }
+    std::stable_sort(tight.begin(), tight.end(), [](auto* a, auto* b) { return a->margin() < b->margin(); });
+    
+    for (size_t i = 0; i < std::min(tight.size(), TIGHT_SHOWN); i++) {
+        auto& p = *tight[i];
+        LOGI("  Tight press at x {:.0f} ({:.1f}%), tick {}: {} early, {} late",
+             p.x, p.x / levelLen * 100, p.tick, p.early, p.late);
+    }
+    if (tight.size() > TIGHT_SHOWN) LOGI("  ...and {} more", tight.size() - TIGHT_SHOWN);
+}
+
+bool SolutionRefiner::refine(std::vector<bool>& inputs, ThreadPool& pool, RefineReport& report,
+                             const std::atomic<bool>* running) {
+    auto t0 = Clock::now();
+    auto stopped = [&]() { return running && !running->load(std::memory_order_relaxed); };
+    m_sims = 0;
+    
+    // The state before every tick, up to the one that completes the level
+    m_inputs = inputs;
+    m_states.assign(1, SimState());
+    m_goalTick = 0;
+    SimState s;
+    for (size_t t = 0; t < m_inputs.size(); t++) {
+        SimplePathfinder::simulateFrame(s, m_inputs[t], m_level, m_tick);
+        if (s.dead) break;
+        m_states.push_back(s);
+        if (s.x >= m_goalX) {
+            m_goalTick = static_cast<uint32_t>(t + 1);
+            break;
+        }
+    }
+    if (m_goalTick == 0) {
+        LOGW("Solution doesn't complete the level when replayed, not refining it");
+        return false;
+    }
+    m_inputs.resize(m_goalTick);
+    
+    report = RefineReport();
+    report.range = m_range;
+    
+    // Drop presses the level can be completed without. Each is screened on
+    // its own in parallel; the ones that pass are confirmed one at a time,
+    // since dropping one press can make another necessary.
+    auto all = presses();
+    report.pressesBefore = all.size();
+    std::vector<uint8_t> ok(all.size());
+    pool.parallelFor(all.size(), GRAIN, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end && !stopped(); i++) {
+            ok[i] = completes({all[i].start, all[i].end, 0, 0});
+        }
+    });
+    for (size_t i = 0; i < all.size() && !stopped(); i++) {
+        Candidate c = {all[i].start, all[i].end, 0, 0};
+        if (ok[i] && completes(c)) {
+            apply(c);
+            report.removed++;
+        }
+    }
+    
+    // Centre each press in its window of working start ticks. Windows are
+    // measured together, so a press is only moved if it still completes
+    // the level after the presses before it moved.
+    all = presses();
+    std::vector<PressMargin> margins;
+    if (!measure(all, pool, running, margins)) return false;
+    for (size_t i = 0; i < all.size(); i++) {
+        int by = (margins[i].late - margins[i].early) / 2;
+        if (by == 0) continue;
+        
+        // A moved press has to stay a press of its own
+        int64_t start = static_cast<int64_t>(all[i].start) + by;
+        int64_t end = static_cast<int64_t>(all[i].end) + by;
+        if (i > 0 && start <= all[i - 1].end) continue;
+        if (i + 1 < all.size() && end >= all[i + 1].start) continue;
+        
+        Candidate c;
+        if (!shifted(all[i], by, c) || !completes(c)) continue;
+        apply(c);
+        all[i].start += by;
+        all[i].end += by;
+        report.moved++;
+    }
+    
+    // Margins of what is actually returned
+    if (!measure(all, pool, running, report.presses) || stopped()) return false;
+    
+    inputs = m_inputs;
+    report.sims = m_sims;
+    report.seconds = std::chrono::duration<double>(Clock::now() - t0).count();
+    return true;
+}
+
+std::vector<SolutionRefiner::Press> SolutionRefiner::presses() const {
+    std::vector<Press> out;
+    uint32_t n = static_cast<uint32_t>(m_inputs.size());
+    for (uint32_t t = 0; t < n; t++) {
+        if (!m_inputs[t] || (t > 0 && m_inputs[t - 1])) continue;
+        uint32_t end = t + 1;
+        while (end < n && m_inputs[end]) end++;
+        out.push_back({t, end});
+    }
+    return out;
+}
+
+// Simulates the candidate from the first tick it changes. Once past the
+// change, meeting the base path means it completes the level like the
+// base does.
+bool SolutionRefiner::completes(const Candidate& c) {
+    m_sims.fetch_add(1, std::memory_order_relaxed);
+    SimState s = m_states[c.from];
+    for (uint32_t t = c.from; t < m_goalTick; t++) {
+        bool click = t < c.to ? t >= c.holdFrom && t < c.holdTo : m_inputs[t];
+        SimplePathfinder::simulateFrame(s, click, m_level, m_tick);
+        if (s.dead) return false;
+        if (s.x >= m_goalX) return true;
+        if (t + 1 >= c.to && sameState(s, m_states[t + 1])) return true;
+    }
+    return false;
+}
+
+// Press `p` started `by` ticks later (earlier if negative), running into a
+// neighbouring press the way a mistimed click would. False if that leaves
+// the inputs.
+bool SolutionRefiner::shifted(const Press& p, int by, Candidate& c) const {
+    int64_t start = static_cast<int64_t>(p.start) + by;
+    int64_t end = static_cast<int64_t>(p.end) + by;
+    if (start < 0 || end > static_cast<int64_t>(m_goalTick)) return false;
+    
+    c.from = std::min(p.start, static_cast<uint32_t>(start));
+    c.to = std::max(p.end, static_cast<uint32_t>(end));
+    c.holdFrom = static_cast<uint32_t>(start);
+    c.holdTo = static_cast<uint32_t>(end);
+    return true;
+}
+
+// Makes the candidate the new base. Its path rejoins the old one where
+// completes() saw it do so, so only the ticks up to there are resimulated.
+void SolutionRefiner::apply(const Candidate& c) {
+    for (uint32_t t = c.from; t < c.to; t++) m_inputs[t] = t >= c.holdFrom && t < c.holdTo;
+    
+    SimState s = m_states[c.from];
+    for (uint32_t t = c.from; t < m_goalTick; t++) {
+        SimplePathfinder::simulateFrame(s, m_inputs[t], m_level, m_tick);
+        if (t + 1 >= c.to && sameState(s, m_states[t + 1])) break;
+        m_states[t + 1] = s;
+    }
+}
+
+// How far every press can move each way, up to the range, against the
+// current base. A press's window ends at the first shift that fails.
+bool SolutionRefiner::measure(const std::vector<Press>& all, ThreadPool& pool, const std::atomic<bool>* running,
+                              std::vector<PressMargin>& out) {
+    size_t shifts = static_cast<size_t>(m_range) * 2;
+    std::vector<uint8_t> ok(all.size() * shifts);
+    pool.parallelFor(ok.size(), GRAIN, [&](size_t begin, size_t end) {
+        for (size_t k = begin; k < end; k++) {
+            if (running && !running->load(std::memory_order_relaxed)) return;
+            size_t i = k / shifts;
+            int step = static_cast<int>(k % shifts) / 2 + 1;
+            int by = k % 2 ? step : -step;
+            Candidate c;
+            ok[k] = shifted(all[i], by, c) && completes(c);
+        }
+    });
+    if (running && !running->load(std::memory_order_relaxed)) return false;
+    
+    out.resize(all.size());
+    for (size_t i = 0; i < all.size(); i++) {
+        auto& m = out[i];
+        m.tick = all[i].start;
+        m.length = all[i].end - all[i].start;
+        m.x = m_states[all[i].start].x;
+        m.early = 0;
+        m.late = 0;
+        const uint8_t* row = &ok[i * shifts];
+        while (m.early < m_range && row[m.early * 2]) m.early++;
+        while (m.late < m_range && row[m.late * 2 + 1]) m.late++;
+    }
+    return true;
+}
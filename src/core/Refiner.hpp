@@ -0,0 +1,105 @@
+#pragma once
+
+#include "BatchPhysics.hpp"
+#include "Level.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class ThreadPool;
+
+// ============================================================================
+// SOLUTION REFINER
+// ============================================================================
+
+// One press of a refined solution: a run of held ticks, and how many
+// ticks it can start earlier or later with the level still completed,
+// counted up to RefineReport::range
+struct PressMargin {
+    uint32_t tick = 0;
+    uint32_t length = 0;
+    float x = 0;
+    int early = 0;
+    int late = 0;
+    
+    int margin() const {
+        return std::min(early, late);
+    }
+};
+
+struct RefineReport {
+    size_t pressesBefore = 0;
+    size_t removed = 0;
+    size_t moved = 0;
+    int range = 0;
+    uint64_t sims = 0;
+    double seconds = 0;
+    std::vector<PressMargin> presses;
+    
+    // Fewest ticks any press can move either way; `range` with no presses
+    int minMargin() const;
+    
+    // Presses that can't move a single tick one way or the other
+    size_t framePerfect() const;
+    
+    // Logs the totals and the tightest presses with where they are, which
+    // is where a wider beam would pay off
+    void log(float levelLen) const;
+};
+
+// Post-processes a solution after the search: drops presses the level
+// can be completed without, then moves each remaining press to the middle
+// of the range of start ticks that still complete the level, so timing
+// errors on replay have the most room either way. Every candidate is
+// simulated from the solution's own state where it first differs, and
+// stops as soon as it is back on the solution's path, so most candidates
+// cost one jump's worth of ticks. Candidates are spread over a pool.
+class SolutionRefiner {
+public:
+    // `goalX` is the x at which the level counts as completed. Press
+    // windows are searched `range` ticks either way.
+    SolutionRefiner(const Level& level, const BatchPhysics::Tick& tick, float goalX, int range)
+        : m_level(level), m_tick(tick), m_goalX(goalX), m_range(std::max(1, range)) {}
+    
+    // Refines `inputs` in place. Returns false, leaving `inputs` alone, if
+    // they don't complete the level or `running` was cleared meanwhile.
+    bool refine(std::vector<bool>& inputs, ThreadPool& pool, RefineReport& report,
+                const std::atomic<bool>* running = nullptr);
+
+private:
+    // Candidates handed to a worker at a time
+    static constexpr size_t GRAIN = 8;
+    
+    struct Press {
+        uint32_t start;
+        uint32_t end;
+    };
+    
+    // The base solution with ticks [from, to) replaced: held in
+    // [holdFrom, holdTo), released elsewhere
+    struct Candidate {
+        uint32_t from, to;
+        uint32_t holdFrom, holdTo;
+    };
+    
+    const Level& m_level;
+    BatchPhysics::Tick m_tick;
+    float m_goalX;
+    int m_range;
+    
+    // Inputs being refined, and the state before every tick of them
+    std::vector<bool> m_inputs;
+    std::vector<SimState> m_states;
+    uint32_t m_goalTick = 0;
+    std::atomic<uint64_t> m_sims{0};
+    
+    std::vector<Press> presses() const;
+    bool completes(const Candidate& c);
+    bool shifted(const Press& p, int by, Candidate& c) const;
+    void apply(const Candidate& c);
+    bool measure(const std::vector<Press>& all, ThreadPool& pool, const std::atomic<bool>* running,
+                 std::vector<PressMargin>& out);
+};
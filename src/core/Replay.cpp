@@ -0,0 +1,178 @@
+#include "Replay.hpp"
+
+#include "Log.hpp"
+#include "Physics.hpp"
+
+#include <cstring>
+#include <fstream>
+#include <system_error>
+
+static constexpr char REPLAY_MAGIC[8] = {'G', 'D', 'P', 'F', 'R', 'P', 'L', 0};
+static constexpr uint32_t REPLAY_VERSION = 2;
+
+struct ReplayHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t physicsVersion;
+    int32_t levelId;
+    uint32_t frames;
+    uint64_t levelHash;
+    uint32_t runCount;
+    uint32_t runBytes;
+    int32_t tickRate;
+    uint32_t reserved;
+};
+static_assert(sizeof(ReplayHeader) == 48, "replay header layout changed");
+
+static void putVarint(std::vector<uint8_t>& out, uint32_t v) {
+    while (v >= 0x80) {
+        out.push_back(static_cast<uint8_t>(v | 0x80));
+        v >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(v));
+}
+
+void Replay::assign(const std::vector<bool>& inputs, size_t count) {
+    m_file.close();
+    m_encoded.clear();
+    m_runCount = 0;
+    
+    bool held = false;
+    uint32_t run = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (inputs[i] != held) {
+            putVarint(m_encoded, run);
+            m_runCount++;
+            held = !held;
+            run = 0;
+        }
+        run++;
+    }
+    putVarint(m_encoded, run);
+    m_runCount++;
+    
+    m_info.physicsVersion = Physics::VERSION;
+    m_runs = m_encoded.data();
+    m_runsSize = m_encoded.size();
+    m_frames = static_cast<uint32_t>(count);
+}
+
+void Replay::clear() {
+    m_file.close();
+    m_encoded.clear();
+    m_info = Info{};
+    m_runs = nullptr;
+    m_runsSize = 0;
+    m_frames = 0;
+    m_runCount = 0;
+}
+
+bool Replay::save(const std::filesystem::path& path) const {
+    std::error_code ec;
+    std::filesystem::create_directories(path.parent_path(), ec);
+    
+    auto tmp = path;
+    tmp += ".tmp";
+    {
+        std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            LOGE("Can't write replay {}", tmp.string());
+            return false;
+        }
+        
+        ReplayHeader h{};
+        std::memcpy(h.magic, REPLAY_MAGIC, sizeof(h.magic));
+        h.version = REPLAY_VERSION;
+        h.physicsVersion = m_info.physicsVersion;
+        h.levelId = m_info.levelId;
+        h.frames = m_frames;
+        h.levelHash = m_info.levelHash;
+        h.runCount = m_runCount;
+        h.runBytes = static_cast<uint32_t>(m_runsSize);
+        h.tickRate = m_info.tickRate;
+        out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+        out.write(reinterpret_cast<const char*>(m_runs), static_cast<std::streamsize>(m_runsSize));
+        
+        if (!out) {
+            LOGE("Failed writing replay {}", tmp.string());
+            return false;
+        }
+    }
+    
+    std::filesystem::rename(tmp, path, ec);
+    if (ec) {
+        LOGE("Can't move replay into place: {}", ec.message());
+        std::filesystem::remove(tmp, ec);
+        return false;
+    }
+    return true;
+}
+
+bool Replay::load(const std::filesystem::path& path) {
+    clear();
+    if (!m_file.open(path)) return false;
+    
+    ByteReader in(m_file.data(), m_file.size());
+    ReplayHeader h;
+    if (!in.read(h) || std::memcmp(h.magic, REPLAY_MAGIC, sizeof(h.magic)) != 0 ||
+        h.version != REPLAY_VERSION) {
+        LOGE("Replay {} has an unknown format", path.string());
+        clear();
+        return false;
+    }
+    if (h.runBytes > in.remaining()) {
+        LOGE("Replay {} is truncated", path.string());
+        clear();
+        return false;
+    }
+    
+    m_runs = m_file.data() + sizeof(h);
+    m_runsSize = h.runBytes;
+    m_frames = h.frames;
+    m_runCount = h.runCount;
+    m_info.levelId = h.levelId;
+    m_info.levelHash = h.levelHash;
+    m_info.physicsVersion = h.physicsVersion;
+    m_info.tickRate = h.tickRate;
+    
+    // The runs have to add up to the frame count, or playback would drift
+    uint64_t total = 0;
+    uint32_t runs = 0;
+    for (size_t pos = 0; pos < m_runsSize; runs++) {
+        uint32_t v = 0;
+        int shift = 0;
+        uint8_t b;
+        do {
+            b = m_runs[pos++];
+            v |= static_cast<uint32_t>(b & 0x7f) << shift;
+            shift += 7;
+        } while ((b & 0x80) && pos < m_runsSize && shift < 32);
+        if (b & 0x80) break;
+        total += v;
+    }
+    if (total != m_frames || runs != m_runCount || m_info.tickRate <= 0) {
+        LOGE("Replay {} is corrupt", path.string());
+        clear();
+        return false;
+    }
+    
+    if (m_info.physicsVersion != Physics::VERSION) {
+        LOGW("Replay {} was recorded with physics version {} (current {})",
+             path.string(), m_info.physicsVersion, Physics::VERSION);
+    }
+    return true;
+}
+
+ReplayCursor Replay::cursorAt(uint32_t frame) const {
+    auto c = cursor();
+    while (c.frame() < frame && !c.done()) c.advance();
+    return c;
+}
+
+std::vector<bool> Replay::inputs() const {
+    std::vector<bool> out(m_frames);
+    for (auto c = cursor(); !c.done(); c.advance()) {
+        out[c.frame()] = c.held();
+    }
+    return out;
+}
@@ -0,0 +1,162 @@
+#pragma once
+
+#include "MappedFile.hpp"
+#include "Physics.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+// ============================================================================
+// REPLAY CURSOR
+// ============================================================================
+
+// Walks encoded runs one frame at a time. Decoding happens in place, so
+// playback never allocates and never touches a vector<bool>.
+class ReplayCursor {
+public:
+    ReplayCursor() = default;
+    ReplayCursor(const uint8_t* runs, size_t size, uint32_t frames)
+        : m_runs(runs), m_size(size), m_frames(frames) {
+        m_runEnd = nextRun();
+        settle();
+    }
+    
+    // Input for the current frame
+    bool held() const { return m_held; }
+    uint32_t frame() const { return m_frame; }
+    uint32_t frames() const { return m_frames; }
+    bool done() const { return m_frame >= m_frames; }
+    
+    void advance() {
+        if (m_frame >= m_frames) return;
+        m_frame++;
+        settle();
+    }
+    
+private:
+    const uint8_t* m_runs = nullptr;
+    size_t m_size = 0;
+    size_t m_pos = 0;
+    uint32_t m_frames = 0;
+    uint32_t m_frame = 0;
+    uint32_t m_runEnd = 0;
+    bool m_held = false;
+    
+    // LEB128; running off the end reads as an endless run
+    uint32_t nextRun() {
+        uint32_t v = 0;
+        for (int shift = 0; m_pos < m_size && shift < 32; shift += 7) {
+            uint8_t b = m_runs[m_pos++];
+            v |= static_cast<uint32_t>(b & 0x7f) << shift;
+            if (!(b & 0x80)) return v;
+        }
+        return m_frames;
+    }
+    
+    // Skips every run that ends at the current frame, including empty ones
+    void settle() {
+        while (m_frame >= m_runEnd && m_pos < m_size) {
+            m_held = !m_held;
+            m_runEnd += nextRun();
+        }
+    }
+};
+
+// ============================================================================
+// TICK CLOCK
+// ============================================================================
+
+// Turns the variable time between rendered frames into whole simulation
+// ticks. Leftover time carries over, so over any stretch of frames the
+// tick count follows elapsed game time whatever the frame rate.
+class TickClock {
+public:
+    explicit TickClock(int rate = Physics::TICK_RATE) : m_rate(rate) {}
+    
+    void reset(int rate) {
+        m_rate = rate;
+        m_pending = 0;
+    }
+    
+    int rate() const { return m_rate; }
+    
+    // Ticks that became due during `dt` seconds
+    int advance(double dt) {
+        m_pending += dt * m_rate;
+        // Frame times that are exact multiples of a tick mustn't round down
+        int ticks = static_cast<int>(m_pending + 1e-6);
+        m_pending -= ticks;
+        return ticks;
+    }
+    
+private:
+    int m_rate;
+    double m_pending = 0;
+};
+
+// ============================================================================
+// REPLAY
+// ============================================================================
+
+// A solution as alternating released/held run lengths, starting with a
+// released run that may be empty. Each length is a LEB128 varint, so a
+// level of tens of thousands of frames takes a few hundred bytes.
+//
+//   header (48 bytes): magic, format version, physics version, level ID,
+//                      frame count, level hash, run count, run bytes,
+//                      tick rate
+//   runs:              varint run lengths
+//
+// Loaded replays point straight into the mapped file.
+class Replay {
+public:
+    struct Info {
+        int32_t levelId = 0;
+        uint64_t levelHash = 0;
+        uint32_t physicsVersion = 0;
+        int32_t tickRate = Physics::TICK_RATE;
+    };
+    
+    Replay() = default;
+    Replay(const Replay&) = delete;
+    Replay& operator=(const Replay&) = delete;
+    
+    // Encodes the first `count` inputs; the buffer is reused between calls
+    void assign(const std::vector<bool>& inputs, size_t count);
+    void assign(const std::vector<bool>& inputs) { assign(inputs, inputs.size()); }
+    
+    void clear();
+    
+    bool save(const std::filesystem::path& path) const;
+    
+    // Fails if the file is missing or corrupt. A replay recorded under a
+    // different physics version loads, but info() reports the mismatch.
+    bool load(const std::filesystem::path& path);
+    
+    Info& info() { return m_info; }
+    const Info& info() const { return m_info; }
+    
+    uint32_t frames() const { return m_frames; }
+    size_t encodedSize() const { return m_runsSize; }
+    
+    ReplayCursor cursor() const {
+        return ReplayCursor(m_runs, m_runsSize, m_frames);
+    }
+    
+    // Cursor positioned at `frame`
+    ReplayCursor cursorAt(uint32_t frame) const;
+    
+    // Decodes into one bool per frame, for tools that need random access
+    std::vector<bool> inputs() const;
+    
+private:
+    Info m_info;
+    MappedFile m_file;
+    std::vector<uint8_t> m_encoded;
+    const uint8_t* m_runs = nullptr;
+    size_t m_runsSize = 0;
+    uint32_t m_frames = 0;
+    uint32_t m_runCount = 0;
+};
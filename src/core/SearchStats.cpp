@@ -0,0 +1,30 @@
+#include "SearchStats.hpp"
+
+#include <fmt/format.h>
+
+static double ms(uint64_t ns) {
+    return ns / 1e6;
+}
+
+static std::string compact(uint64_t n) {
+    if (n >= 1000000000) return fmt::format("{:.1f}G", n / 1e9);
+    if (n >= 1000000) return fmt::format("{:.1f}M", n / 1e6);
+    if (n >= 1000) return fmt::format("{:.1f}k", n / 1e3);
+    return fmt::format("{}", n);
+}
+
+std::string SearchStats::logLine(int frame) const {
+    return fmt::format(
+        "PFSTATS frame={} expanded={} dead={} doomed={} dup={} width={} allocs={} compactions={} "
+        "expand_ms={:.1f} physics_ms={:.1f} collide_ms={:.1f} merge_ms={:.1f} select_ms={:.1f}",
+        frame, expanded, prunedDead, prunedDoomed, prunedDuplicate, prunedWidth, allocations, compactions,
+        ms(expandNs), ms(physicsNs), ms(collideNs), ms(mergeNs), ms(selectNs));
+}
+
+std::string SearchStats::summary() const {
+    return fmt::format(
+        "exp {:.0f}ms  phys {:.0f}ms  col {:.0f}ms  merge {:.0f}ms  sel {:.0f}ms\n"
+        "dead {}  doomed {}  dup {}  width {}  allocs {}  gc {}",
+        ms(expandNs), ms(physicsNs), ms(collideNs), ms(mergeNs), ms(selectNs),
+        compact(prunedDead), compact(prunedDoomed), compact(prunedDuplicate), compact(prunedWidth), allocations, compactions);
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// ============================================================================
+// SEARCH STATS
+// ============================================================================
+
+// Per-phase counters for one search run, cumulative since start()
+struct SearchStats {
+    uint64_t expanded = 0;          // children simulated
+    uint64_t prunedDead = 0;        // children that hit a hazard
+    uint64_t prunedDuplicate = 0;   // children merged by the dedup grid
+    uint64_t prunedWidth = 0;       // survivors dropped by the beam width
+    uint64_t prunedDoomed = 0;      // children in a danger map cell
+    uint64_t allocations = 0;       // search buffer (re)allocations
+    uint64_t compactions = 0;       // input tree compactions under the memory cap
+    
+    uint64_t expandNs = 0;          // wall time of the parallel expansion
+    uint64_t physicsNs = 0;         // batched kernel, summed over workers
+    uint64_t collideNs = 0;         // collision, summed over workers
+    uint64_t mergeNs = 0;           // dedup and input-tree appends
+    uint64_t selectNs = 0;          // width adaptation and selection
+    
+    // Single key=value line for the log
+    std::string logLine(int frame) const;
+    
+    // Short two-line form for the popup
+    std::string summary() const;
+};
@@ -0,0 +1,128 @@
+#include "SolveQueue.hpp"
+
+#include "LevelIO.hpp"
+#include "Log.hpp"
+#include "Replay.hpp"
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <ctime>
+#include <fstream>
+#include <system_error>
+
+using Clock = std::chrono::steady_clock;
+
+static double secondsSince(Clock::time_point t0) {
+    return std::chrono::duration<double>(Clock::now() - t0).count();
+}
+
+std::vector<SolveResult> SolveQueue::run(const std::vector<SolveJob>& jobs, const ResultFn& onResult) {
+    std::vector<SolveResult> results(jobs.size());
+    if (jobs.empty()) return results;
+    
+    int parallel = std::min(m_config.parallelLevels(), static_cast<int>(jobs.size()));
+    
+    // Levels running side by side share the memory limits, and a per-level
+    // checkpoint file would be overwritten by every other level
+    SearchConfig cfg = m_config.search;
+    cfg.memoryBudgetMB = std::max(1, cfg.memoryBudgetMB / parallel);
+    cfg.memoryCapMB = std::max(1, cfg.memoryCapMB / parallel);
+    cfg.checkpointPath.clear();
+    
+    if (!m_config.replayDir.empty()) {
+        std::error_code ec;
+        std::filesystem::create_directories(m_config.replayDir, ec);
+    }
+    
+    LOGI("Solving {} levels, {} at a time with {} threads each", jobs.size(), parallel, cfg.threadCount());
+    auto t0 = Clock::now();
+    
+    // One level per chunk, so idle participants steal whole levels
+    ThreadPool pool(parallel);
+    pool.parallelFor(jobs.size(), 1, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            results[i] = solve(jobs[i], cfg);
+            append(results[i]);
+            if (onResult) onResult(results[i]);
+        }
+    });
+    
+    size_t solved = std::count_if(results.begin(), results.end(), [](auto& r) { return r.solved; });
+    LOGI("Solved {} of {} levels in {:.1f}s", solved, jobs.size(), secondsSince(t0));
+    return results;
+}
+
+SolveResult SolveQueue::solve(const SolveJob& job, const SearchConfig& cfg) {
+    SolveResult r;
+    r.name = job.name;
+    
+    auto t0 = Clock::now();
+    std::shared_ptr<Level> level = job.levelPath.extension() == ".bin"
+        ? loadLevelCache(job.levelPath)
+        : loadLevelText(job.levelPath);
+    r.loadSeconds = secondsSince(t0);
+    if (!level) {
+        LOGE("Can't load level {} from {}", job.name, job.levelPath.string());
+        return r;
+    }
+    r.loaded = true;
+    r.levelHash = hashLevel(*level);
+    
+    t0 = Clock::now();
+    SimplePathfinder pf;
+    pf.run(level, cfg);
+    r.searchSeconds = secondsSince(t0);
+    
+    auto& snap = pf.latest();
+    r.solved = snap.found;
+    r.frames = snap.frame;
+    r.inputs = snap.found ? snap.solution().size() : 0;
+    r.nodes = snap.nodes;
+    r.expanded = snap.stats.expanded;
+    r.progress = snap.progress;
+    r.margin = snap.margin;
+    
+    if (r.solved && !m_config.replayDir.empty()) {
+        Replay replay;
+        replay.assign(snap.solution());
+        replay.info().levelHash = r.levelHash;
+        replay.info().tickRate = snap.tickRate;
+        
+        // Names that are level IDs go into the replay too
+        int id = 0;
+        auto [end, ec] = std::from_chars(job.name.data(), job.name.data() + job.name.size(), id);
+        if (ec == std::errc() && end == job.name.data() + job.name.size()) replay.info().levelId = id;
+        
+        auto path = m_config.replayDir / (job.name + ".gdr");
+        if (replay.save(path)) r.replayPath = path;
+    }
+    
+    LOGI("{}: {} in {:.1f}s ({} nodes, {:.1f}%)", job.name, r.solved ? "solved" : "failed",
+         r.searchSeconds, r.nodes, r.progress * 100);
+    return r;
+}
+
+std::string SolveQueue::resultLine(const SolveResult& r) const {
+    auto& s = m_config.search;
+    return fmt::format(
+        "PFSOLVE at={} level={} result={} hash={:016x} inputs={} frames={} nodes={} expanded={} "
+        "progress={:.1f} load_s={:.3f} search_s={:.3f} width={} tick={} physics={} margin={} replay={}",
+        static_cast<long long>(std::time(nullptr)), r.name,
+        !r.loaded ? "unreadable" : r.solved ? "solved" : "failed",
+        r.levelHash, r.inputs, r.frames, r.nodes, r.expanded, r.progress * 100, r.loadSeconds, r.searchSeconds,
+        s.beamWidth, s.tickRate, Physics::VERSION, r.margin, r.replayPath.empty() ? "-" : r.replayPath.string());
+}
+
+// Opened per line and closed right after, so a queue killed halfway keeps
+// every level it finished
+void SolveQueue::append(const SolveResult& r) {
+    if (m_config.resultsPath.empty()) return;
+    auto line = resultLine(r);
+    
+    std::lock_guard<std::mutex> lock(m_appendMtx);
+    std::ofstream out(m_config.resultsPath, std::ios::app);
+    out << line << "\n";
+    if (!out) LOGE("Can't append to results file {}", m_config.resultsPath.string());
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include "Pathfinder.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// ============================================================================
+// SOLVE QUEUE
+// ============================================================================
+
+// One level to solve: an exported level file or a level cache
+struct SolveJob {
+    std::string name;
+    std::filesystem::path levelPath;
+};
+
+struct SolveResult {
+    std::string name;
+    bool loaded = false;
+    bool solved = false;
+    uint64_t levelHash = 0;
+    double loadSeconds = 0;
+    double searchSeconds = 0;
+    int frames = 0;
+    size_t inputs = 0;
+    size_t nodes = 0;
+    uint64_t expanded = 0;
+    float progress = 0;
+    
+    // Fewest ticks any press of the saved solution can move, -1 if it
+    // wasn't refined
+    int margin = -1;
+    
+    // Empty unless the solution was saved
+    std::filesystem::path replayPath;
+};
+
+struct QueueConfig {
+    // Applied to every level. workerThreads is per level, and the memory
+    // limits are shared by the levels running at once.
+    SearchConfig search;
+    
+    // Levels solved at once; 0 fills every core
+    int parallel = 0;
+    
+    // Append-only results file; empty keeps results in memory only
+    std::filesystem::path resultsPath;
+    
+    // Where solutions are saved as <name>.gdr; empty doesn't save them
+    std::filesystem::path replayDir;
+    
+    int parallelLevels() const {
+        if (parallel > 0) return parallel;
+        int cores = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+        return std::max(1, cores / search.threadCount());
+    }
+};
+
+// Loads and searches a list of levels back to back through the headless
+// core. Levels run side by side on a thread pool rather than one after the
+// other with a wide search each, because throughput over the whole list is
+// what counts and a beam scales worse across cores than independent
+// levels do. Every finished level appends one line to the results file:
+//
+//   PFSOLVE at=<unix time> level=<name> result=<solved|failed|unreadable>
+//           hash=<level hash> inputs=.. frames=.. nodes=.. expanded=..
+//           progress=.. load_s=.. search_s=.. width=.. tick=.. physics=..
+//           margin=<ticks or -1> replay=<path or ->
+//
+// all on one line, so the file collects a history across code changes.
+class SolveQueue {
+public:
+    using ResultFn = std::function<void(const SolveResult&)>;
+    
+    explicit SolveQueue(QueueConfig cfg) : m_config(std::move(cfg)) {}
+    
+    // Solves every job and returns the results in job order. `onResult` is
+    // called as each level finishes, from the thread that solved it.
+    std::vector<SolveResult> run(const std::vector<SolveJob>& jobs, const ResultFn& onResult = {});
+    
+    // The results file line for `r`, without the newline
+    std::string resultLine(const SolveResult& r) const;
+
+private:
+    QueueConfig m_config;
+    std::mutex m_appendMtx;
+    
+    SolveResult solve(const SolveJob& job, const SearchConfig& cfg);
+    void append(const SolveResult& r);
+};
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// ============================================================================
+// THREAD POOL
+// ============================================================================
+
+// Persistent workers for data-parallel loops. Every participant owns a
+// contiguous slice of chunks and pulls from it with an atomic cursor; once
+// its slice is drained it steals from the other slices the same way.
+// The calling thread takes part as participant 0.
+class ThreadPool {
+public:
+    explicit ThreadPool(int threads) : m_size(std::max(1, threads)) {
+        m_cursors = std::make_unique<Cursor[]>(m_size);
+        for (int i = 1; i < m_size; i++) {
+            m_threads.emplace_back([this, i]() { workerLoop(i); });
+        }
+    }
+    
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(m_mtx);
+            m_quit = true;
+        }
+        m_wake.notify_all();
+        for (auto& t : m_threads) t.join();
+    }
+    
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+    
+    int size() const {
+        return m_size;
+    }
+    
+    // Calls fn(begin, end) over [0, count) in chunks of `grain` items and
+    // returns once every chunk has run.
+    template <class F>
+    void parallelFor(size_t count, size_t grain, F&& fn) {
+        if (count == 0) return;
+        grain = std::max<size_t>(1, grain);
+        size_t chunks = (count + grain - 1) / grain;
+        
+        if (m_size == 1 || chunks == 1) {
+            fn(size_t(0), count);
+            return;
+        }
+        
+        std::function<void(size_t, size_t)> job = std::forward<F>(fn);
+        {
+            std::lock_guard<std::mutex> lock(m_mtx);
+            m_job = &job;
+            m_count = count;
+            m_grain = grain;
+            for (int i = 0; i < m_size; i++) {
+                m_cursors[i].next = chunks * i / m_size;
+                m_cursors[i].end = chunks * (i + 1) / m_size;
+            }
+            m_pending = m_size - 1;
+            m_generation++;
+        }
+        m_wake.notify_all();
+        
+        runChunks(0);
+        
+        std::unique_lock<std::mutex> lock(m_mtx);
+        m_done.wait(lock, [this]() { return m_pending == 0; });
+        m_job = nullptr;
+    }
+    
+private:
+    struct alignas(64) Cursor {
+        std::atomic<size_t> next{0};
+        size_t end = 0;
+    };
+    
+    int m_size;
+    std::vector<std::thread> m_threads;
+    std::unique_ptr<Cursor[]> m_cursors;
+    
+    std::mutex m_mtx;
+    std::condition_variable m_wake;
+    std::condition_variable m_done;
+    uint64_t m_generation = 0;
+    int m_pending = 0;
+    bool m_quit = false;
+    
+    std::function<void(size_t, size_t)>* m_job = nullptr;
+    size_t m_count = 0;
+    size_t m_grain = 1;
+    
+    void runChunks(int self) {
+        for (int k = 0; k < m_size; k++) {
+            auto& cur = m_cursors[(self + k) % m_size];
+            while (true) {
+                size_t c = cur.next.fetch_add(1);
+                if (c >= cur.end) break;
+                size_t begin = c * m_grain;
+                (*m_job)(begin, std::min(m_count, begin + m_grain));
+            }
+        }
+    }
+    
+    void workerLoop(int self) {
+        uint64_t seen = 0;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(m_mtx);
+                m_wake.wait(lock, [&]() { return m_quit || m_generation != seen; });
+                if (m_quit) return;
+                seen = m_generation;
+            }
+            
+            runChunks(self);
+            
+            {
+                std::lock_guard<std::mutex> lock(m_mtx);
+                m_pending--;
+            }
+            m_done.notify_one();
+        }
+    }
+};
@@ -0,0 +1,304 @@
+#include "Triggers.hpp"
+
+#include "BatchPhysics.hpp"
+#include "Log.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <map>
+#include <unordered_map>
+#include <utility>
+
+// Rotations are followed along their arc with a key every this many degrees
+static constexpr float ROTATE_STEP = 15;
+
+// Keys closer than this to the line through their neighbours are dropped
+static constexpr float KEY_EPS = 0.01f;
+
+// ============================================================================
+// PLAYER CLOCK
+// ============================================================================
+
+// Player x against time since the start, one linear piece per speed
+// portal. Uses the simulated speed, so tracks line up with the states the
+// search produces rather than with the game's.
+class PlayerClock {
+public:
+    explicit PlayerClock(const std::vector<LevelObject>& objects) {
+        std::vector<std::pair<float, float>> changes;
+        for (auto& o : objects) {
+            if (isSpeedPortal(o.portal)) changes.push_back({o.x, portalSpeed(o.portal)});
+        }
+        std::stable_sort(changes.begin(), changes.end(),
+            [](auto& a, auto& b) { return a.first < b.first; });
+        
+        m_pieces.push_back({0, 0, unitsPerSecond(1)});
+        for (auto& [x, speed] : changes) {
+            auto& last = m_pieces.back();
+            if (x <= 0) {
+                last.v = unitsPerSecond(speed);
+                continue;
+            }
+            m_pieces.push_back({x, last.t + (x - last.x) / last.v, unitsPerSecond(speed)});
+        }
+    }
+    
+    float timeAt(float x) const {
+        auto it = std::upper_bound(m_pieces.begin() + 1, m_pieces.end(), x,
+            [](float v, const Piece& p) { return v < p.x; });
+        auto& p = *std::prev(it);
+        return p.t + (x - p.x) / p.v;
+    }
+    
+    float xAt(float t) const {
+        auto it = std::upper_bound(m_pieces.begin() + 1, m_pieces.end(), t,
+            [](float v, const Piece& p) { return v < p.t; });
+        auto& p = *std::prev(it);
+        return p.x + (t - p.t) * p.v;
+    }
+    
+    // Calls fn(x) for each speed change strictly inside (x0, x1)
+    template <class F>
+    void forEachChange(float x0, float x1, F&& fn) const {
+        for (size_t i = 1; i < m_pieces.size(); i++) {
+            if (m_pieces[i].x > x0 && m_pieces[i].x < x1) fn(m_pieces[i].x);
+        }
+    }
+
+private:
+    struct Piece {
+        float x, t, v;
+    };
+    std::vector<Piece> m_pieces;
+    
+    static float unitsPerSecond(float speed) {
+        auto tick = BatchPhysics::DEFAULT_TICK.atSpeed(speed);
+        return tick.xStep * static_cast<float>(tick.rate);
+    }
+};
+
+// ============================================================================
+// TIMELINES
+// ============================================================================
+
+// A trigger placed on the player's x axis
+struct Fired {
+    const RawTrigger* trig;
+    float x0, x1;
+    float t0;
+    
+    bool instant() const { return trig->duration <= 0; }
+    
+    // How far through its effect the trigger is for a player at x, time t
+    float fraction(float x, float t) const {
+        if (instant()) return x >= x0 ? 1.0f : 0.0f;
+        return std::clamp((t - t0) / trig->duration, 0.0f, 1.0f);
+    }
+};
+
+// Offset and state of one object for a player at x. Moves add up; each
+// rotation turns the object's start position about its own pivot and the
+// displacements add up too. The last toggle fired wins.
+static TrackKey evaluate(const std::vector<const Fired*>& list, float x, float baseX, float baseY,
+                         const PlayerClock& clock) {
+    float t = clock.timeAt(x);
+    TrackKey key{x, 0, 0, 1};
+    float toggledAt = -std::numeric_limits<float>::infinity();
+    
+    for (auto f : list) {
+        auto& trig = *f->trig;
+        float frac = f->fraction(x, t);
+        switch (trig.kind) {
+            case TriggerKind::Move:
+                key.dx += trig.dx * frac;
+                key.dy += trig.dy * frac;
+                break;
+            case TriggerKind::Rotate:
+                if (trig.hasPivot && frac > 0) {
+                    float a = trig.degrees * frac * 3.14159265f / 180;
+                    float rx = baseX - trig.pivotX, ry = baseY - trig.pivotY;
+                    float c = std::cos(a), s = std::sin(a);
+                    key.dx += rx * c + ry * s - rx;
+                    key.dy += -rx * s + ry * c - ry;
+                }
+                break;
+            case TriggerKind::Toggle:
+                if (x >= f->x0 && f->x0 >= toggledAt) {
+                    toggledAt = f->x0;
+                    key.active = trig.activate;
+                }
+                break;
+            case TriggerKind::Alpha:
+                break;
+        }
+    }
+    return key;
+}
+
+// Keys at every point where the offset stops being linear in player x:
+// trigger starts and ends, speed changes inside a move, steps along an arc,
+// and just before every instant change
+static std::vector<TrackKey> timeline(const std::vector<const Fired*>& list, float baseX, float baseY,
+                                      const PlayerClock& clock) {
+    std::vector<float> xs = {0};
+    for (auto f : list) {
+        xs.push_back(f->x0);
+        if (f->instant()) {
+            if (f->x0 > 0) xs.push_back(std::nextafter(f->x0, -std::numeric_limits<float>::infinity()));
+            continue;
+        }
+        xs.push_back(f->x1);
+        clock.forEachChange(f->x0, f->x1, [&](float x) { xs.push_back(x); });
+        if (f->trig->kind == TriggerKind::Rotate) {
+            int steps = static_cast<int>(std::ceil(std::abs(f->trig->degrees) / ROTATE_STEP));
+            for (int k = 1; k < steps; k++) {
+                xs.push_back(clock.xAt(f->t0 + f->trig->duration * k / steps));
+            }
+        }
+    }
+    std::sort(xs.begin(), xs.end());
+    xs.erase(std::unique(xs.begin(), xs.end()), xs.end());
+    
+    std::vector<TrackKey> keys;
+    keys.reserve(xs.size());
+    for (float x : xs) {
+        auto key = evaluate(list, x, baseX, baseY, clock);
+        
+        // Drop the previous key if it lies on the line from its neighbour
+        // to this one
+        if (keys.size() >= 2) {
+            auto& a = keys[keys.size() - 2];
+            auto& b = keys.back();
+            float f = (b.px - a.px) / (key.px - a.px);
+            if (a.active == b.active && b.active == key.active &&
+                std::abs(a.dx + (key.dx - a.dx) * f - b.dx) < KEY_EPS &&
+                std::abs(a.dy + (key.dy - a.dy) * f - b.dy) < KEY_EPS) {
+                keys.pop_back();
+            }
+        }
+        keys.push_back(key);
+    }
+    return keys;
+}
+
+static bool isStill(const std::vector<TrackKey>& keys) {
+    return std::all_of(keys.begin(), keys.end(),
+        [](auto& k) { return k.active && k.dx == 0 && k.dy == 0; });
+}
+
+// ============================================================================
+// BUILD
+// ============================================================================
+
+MotionTracks buildMotion(std::vector<LevelObject>& objects, const std::vector<GroupList>& groups,
+                         const std::vector<RawTrigger>& triggers, const std::atomic<bool>* cancel) {
+    MotionTracks motion;
+    if (triggers.empty()) return motion;
+    
+    PlayerClock clock(objects);
+    
+    // Triggers left of the start have all fired by the time the player moves
+    std::vector<Fired> fired(triggers.size());
+    std::unordered_map<int, std::vector<uint32_t>> byGroup;
+    size_t alpha = 0;
+    for (size_t i = 0; i < triggers.size(); i++) {
+        auto& trig = triggers[i];
+        auto& f = fired[i];
+        f.trig = &trig;
+        f.x0 = std::max(0.0f, trig.x);
+        f.t0 = clock.timeAt(f.x0);
+        f.x1 = f.instant() ? f.x0 : clock.xAt(f.t0 + trig.duration);
+        
+        if (trig.kind == TriggerKind::Alpha) {
+            alpha++;
+        } else if (trig.group > 0) {
+            byGroup[trig.group].push_back(static_cast<uint32_t>(i));
+        }
+    }
+    
+    // Objects moved by the same set of triggers share keys, unless one of
+    // them rotates, which depends on where the object starts
+    std::map<std::vector<uint32_t>, std::pair<uint32_t, uint32_t>> shared;
+    std::vector<uint32_t> ids;
+    std::vector<const Fired*> list;
+    size_t hidden = 0;
+    
+    for (size_t i = 0; i < objects.size() && i < groups.size(); i++) {
+        if (cancel && cancel->load(std::memory_order_relaxed)) return {};
+        
+        auto& obj = objects[i];
+        if (obj.portal != Portal::None || groups[i].count == 0) continue;
+        
+        ids.clear();
+        for (int g = 0; g < groups[i].count; g++) {
+            auto it = byGroup.find(groups[i].ids[g]);
+            if (it != byGroup.end()) ids.insert(ids.end(), it->second.begin(), it->second.end());
+        }
+        if (ids.empty()) continue;
+        std::sort(ids.begin(), ids.end());
+        ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+        
+        list.clear();
+        bool turns = false;
+        for (auto id : ids) {
+            list.push_back(&fired[id]);
+            turns |= triggers[id].kind == TriggerKind::Rotate;
+        }
+        
+        Track track{};
+        if (auto it = shared.find(ids); !turns && it != shared.end()) {
+            if (it->second.second == 0) continue;
+            track.firstKey = it->second.first;
+            track.keyCount = it->second.second;
+        } else {
+            auto keys = timeline(list, obj.x, obj.y, clock);
+            bool still = !turns && isStill(keys);
+            track.firstKey = static_cast<uint32_t>(motion.keys.size());
+            track.keyCount = still ? 0 : static_cast<uint32_t>(keys.size());
+            if (!turns) shared.emplace(ids, std::make_pair(track.firstKey, track.keyCount));
+            if (still) continue;
+            motion.keys.insert(motion.keys.end(), keys.begin(), keys.end());
+        }
+        
+        // A turning object can face any way, so it gets the box of every turn
+        track.x = obj.x;
+        track.y = obj.y;
+        track.w = turns ? std::hypot(obj.w, obj.h) : obj.w;
+        track.h = turns ? std::hypot(obj.w, obj.h) : obj.h;
+        
+        // Offsets are linear between keys, so the keys bound the sweep
+        float x0 = std::numeric_limits<float>::infinity(), y0 = x0;
+        float x1 = -x0, y1 = -x0;
+        for (uint32_t k = track.firstKey; k < track.firstKey + track.keyCount; k++) {
+            auto& key = motion.keys[k];
+            if (!key.active) continue;
+            x0 = std::min(x0, track.x + key.dx - track.w / 2);
+            x1 = std::max(x1, track.x + key.dx + track.w / 2);
+            y0 = std::min(y0, track.y + key.dy - track.h / 2);
+            y1 = std::max(y1, track.y + key.dy + track.h / 2);
+        }
+        if (x0 > x1) {
+            // Never collides; marked for removal below
+            obj.w = -1;
+            hidden++;
+            continue;
+        }
+        
+        obj.x = (x0 + x1) / 2;
+        obj.y = (y0 + y1) / 2;
+        obj.w = x1 - x0;
+        obj.h = y1 - y0;
+        obj.track = static_cast<uint32_t>(motion.tracks.size());
+        motion.tracks.push_back(track);
+    }
+    
+    if (hidden) {
+        objects.erase(std::remove_if(objects.begin(), objects.end(), [](auto& o) { return o.w < 0; }),
+                      objects.end());
+    }
+    
+    LOGI("Triggers: {} moving objects, {} keys, {} never active", motion.tracks.size(), motion.keys.size(), hidden);
+    if (alpha) LOGI("Ignoring {} alpha triggers, which don't change hitboxes", alpha);
+    return motion;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "Level.hpp"
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// ============================================================================
+// TRIGGERS
+// ============================================================================
+
+// Triggers that change where objects collide. Alpha only fades: the game
+// keeps the hitbox of an invisible object, so alpha triggers never change
+// a track and are only counted.
+enum class TriggerKind : uint8_t {
+    Move, Rotate, Toggle, Alpha,
+};
+
+// One trigger as read from the scene, fired when the player reaches x.
+// Spawn and touch triggered ones aren't tied to x and are left out.
+struct RawTrigger {
+    TriggerKind kind = TriggerKind::Move;
+    float x = 0;
+    int group = 0;
+    float duration = 0;         // seconds, 0 for instant
+    float dx = 0, dy = 0;       // move offset
+    float degrees = 0;          // rotation, clockwise
+    bool hasPivot = false;      // otherwise objects turn in place
+    float pivotX = 0, pivotY = 0;
+    bool activate = true;       // toggle on or off
+};
+
+// Groups of one object, as many as the game allows
+struct GroupList {
+    static constexpr int MAX = 10;
+    std::array<uint16_t, MAX> ids{};
+    uint8_t count = 0;
+};
+
+// Evaluates `triggers` into motion tracks for `objects`, where groups[i]
+// lists the groups of objects[i]. Every hazard or solid a trigger moves,
+// turns or toggles gets a track and is widened to the box it sweeps over
+// the whole level. Trigger durations turn into player x through the speed
+// portals among `objects`. Portals stay where they are. Once `cancel` is
+// set it gives up and returns no tracks, leaving `objects` part widened.
+MotionTracks buildMotion(std::vector<LevelObject>& objects, const std::vector<GroupList>& groups,
+                         const std::vector<RawTrigger>& triggers,
+                         const std::atomic<bool>* cancel = nullptr);
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <atomic>
+
+// ============================================================================
+// TRIPLE BUFFER
+// ============================================================================
+
+// Lock-free single-producer / single-consumer latest-value channel. The
+// producer fills back() and publishes it; the consumer always sees the most
+// recent complete value. Neither side ever waits on the other.
+template <class T>
+class TripleBuffer {
+public:
+    // Producer side. The returned buffer holds stale data and must be fully
+    // rewritten before publish().
+    T& back() {
+        return m_bufs[m_back];
+    }
+    
+    void publish() {
+        m_back = m_middle.exchange(m_back | DIRTY, std::memory_order_acq_rel) & INDEX;
+    }
+    
+    // Consumer side
+    const T& read() {
+        if (m_middle.load(std::memory_order_relaxed) & DIRTY) {
+            m_front = m_middle.exchange(m_front, std::memory_order_acq_rel) & INDEX;
+        }
+        return m_bufs[m_front];
+    }
+    
+private:
+    static constexpr int INDEX = 0x3;
+    static constexpr int DIRTY = 0x4;
+    
+    T m_bufs[3];
+    int m_back = 0;
+    std::atomic<int> m_middle{1};
+    int m_front = 2;
+};
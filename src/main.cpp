@@ -1,16 +1,27 @@
 #include <Geode/Geode.hpp>
 #include <Geode/modify/PlayLayer.hpp>
+#include <Geode/modify/GJBaseGameLayer.hpp>
 #include <Geode/modify/LevelInfoLayer.hpp>
 #include <Geode/modify/MenuLayer.hpp>
 #include <Geode/ui/GeodeUI.hpp>
 
+#include "core/Level.hpp"
+#include "core/LevelIO.hpp"
+#include "core/LevelStream.hpp"
+#include "core/Lockstep.hpp"
+#include "core/Log.hpp"
+#include "core/ObjectTable.hpp"
+#include "core/Pathfinder.hpp"
+#include "core/Physics.hpp"
+#include "core/Replay.hpp"
+#include "core/Triggers.hpp"
+
 #include <vector>
-#include <thread>
-#include <atomic>
-#include <mutex>
-#include <chrono>
+#include <memory>
 #include <cmath>
 #include <algorithm>
+#include <unordered_map>
+#include <thread>
 
 using namespace geode::prelude;
 
@@ -18,77 +29,68 @@ using namespace geode::prelude;
 // SIMPLE LOGGING
 // ============================================================================
 
-#define LOGD(...) geode::log::debug(__VA_ARGS__)
-#define LOGI(...) geode::log::info(__VA_ARGS__)
-#define LOGW(...) geode::log::warn(__VA_ARGS__)
-#define LOGE(...) geode::log::error(__VA_ARGS__)
-
-// ============================================================================
-// PHYSICS CONSTANTS
-// ============================================================================
-
-namespace Physics {
-    constexpr float BLOCK = 30.0f;
-    constexpr float GRAVITY = 0.958199f;
-    constexpr float JUMP_VEL = 11.180032f;
-    constexpr float XVEL = 5.770002f;
-}
-
-// ============================================================================
-// SIMPLE RECT
-// ============================================================================
-
-struct HitRect {
-    float x, y, w, h;
-    
-    bool intersects(const HitRect& o) const {
-        return !((x + w) <= o.x || (o.x + o.w) <= x ||
-                 (y + h) <= o.y || (o.y + o.h) <= y);
+static void geodeLogSink(Log::Level level, const std::string& msg) {
+    switch (level) {
+        case Log::Level::Debug: geode::log::debug("{}", msg); break;
+        case Log::Level::Info: geode::log::info("{}", msg); break;
+        case Log::Level::Warn: geode::log::warn("{}", msg); break;
+        case Log::Level::Error: geode::log::error("{}", msg); break;
     }
-};
-
-// ============================================================================
-// LEVEL OBJECT
-// ============================================================================
-
-struct LevelObject {
-    int id;
-    float x, y, w, h;
-    bool isHazard;
-    bool isSolid;
-};
+}
 
 // ============================================================================
-// PLAYER SIM STATE
+// SETTINGS
 // ============================================================================
 
-struct SimState {
-    float x = 0, y = 105;
-    float velY = 0;
-    bool onGround = true;
-    bool dead = false;
-    bool won = false;
-    int frame = 0;
-};
+static SearchConfig configFromSettings() {
+    SearchConfig cfg;
+    auto mod = Mod::get();
+    cfg.beamWidth = static_cast<int>(mod->getSettingValue<int64_t>("beam-width"));
+    cfg.adaptiveBeam = mod->getSettingValue<bool>("adaptive-beam");
+    cfg.memoryBudgetMB = static_cast<int>(mod->getSettingValue<int64_t>("beam-memory-mb"));
+    cfg.memoryCapMB = static_cast<int>(mod->getSettingValue<int64_t>("memory-cap-mb"));
+    cfg.workerThreads = static_cast<int>(mod->getSettingValue<int64_t>("worker-threads"));
+    cfg.tickRate = static_cast<int>(mod->getSettingValue<int64_t>("tick-rate"));
+    cfg.segmented = mod->getSettingValue<bool>("segmented-search");
+    cfg.decisionPoints = mod->getSettingValue<bool>("decision-points");
+    cfg.heuristic.kind = heuristicFromName(mod->getSettingValue<std::string>("heuristic"));
+    cfg.dangerMap = mod->getSettingValue<bool>("danger-map");
+    cfg.refine = mod->getSettingValue<bool>("refine-solutions");
+    cfg.heuristic.lookaheadFrames = static_cast<int>(mod->getSettingValue<int64_t>("lookahead-frames"));
+    cfg.checkpointSeconds = static_cast<int>(mod->getSettingValue<int64_t>("checkpoint-interval"));
+    return cfg;
+}
 
 // ============================================================================
 // LEVEL ANALYZER
 // ============================================================================
 
+// Extracts level geometry from the running PlayLayer into a core Level.
+// The main thread only copies the raw object and trigger data;
+// classification, trigger evaluation and the index build run on a
+// LevelStream, which a search can start on before it is done. Each
+// analysis produces a fresh Level, so a search still reading the previous
+// one is never disturbed.
 class LevelAnalyzer {
 public:
-    std::vector<LevelObject> objects;
-    float levelLength = 0;
+    std::shared_ptr<const Level> level;
     bool loaded = false;
     
+    // Set while the analyzed level is still being built
+    std::shared_ptr<LevelStream> stream;
+    
+    // Where searches on the analyzed level keep their checkpoint, and
+    // where its solution is saved
+    std::filesystem::path checkpointPath;
+    std::filesystem::path replayPath;
+    int levelId = 0;
+    
     static LevelAnalyzer& get() {
         static LevelAnalyzer instance;
         return instance;
     }
     
     void analyze(PlayLayer* pl) {
-        objects.clear();
-        levelLength = 0;
         loaded = false;
         
         if (!pl) {
@@ -96,6 +98,42 @@ public:
             return;
         }
         
+        // The old stream classifies with its own copy of the object table,
+        // so it only has to be told to stop. Releasing it waits for its
+        // build thread, which is left to a worker rather than the game.
+        if (stream) {
+            stream->cancel();
+            std::thread([old = std::move(stream)]() mutable { old.reset(); }).detach();
+        }
+        
+        // Overrides are re-read every time, so edits apply on the next attempt
+        auto tablePath = Mod::get()->getSaveDir() / "objects.txt";
+        if (std::filesystem::exists(tablePath)) {
+            ObjectTable::get().loadOverrides(tablePath);
+        } else {
+            ObjectTable::get().reset();
+        }
+        
+        // Levels already walked once load straight from the cache
+        uint64_t key = cacheKey(pl);
+        auto cachePath = cachePathFor(pl, key, "cache", "bin");
+        checkpointPath = cachePathFor(pl, key, "checkpoints", "ckpt");
+        replayPath = cachePathFor(pl, key, "replays", "gdr");
+        levelId = pl->m_level ? pl->m_level->m_levelID.value() : 0;
+        if (auto cached = loadLevelCache(cachePath, key)) {
+            level = cached;
+            loaded = !level->objects.empty();
+            LOGI("Loaded level from cache {}", cachePath.string());
+            level->logSummary();
+            return;
+        }
+        
+        m_raw.clear();
+        m_triggers.clear();
+        m_pivots.clear();
+        m_groupPos.clear();
+        m_skippedTriggers = 0;
+        
         LOGI("=== ANALYZING LEVEL ===");
         
         // Debug: print all member info
@@ -103,13 +141,14 @@ public:
         LOGI("m_levelLength: {}", pl->m_levelLength);
         
         // Use m_levelLength directly
-        levelLength = pl->m_levelLength;
-        if (levelLength < 100) levelLength = 5000; // Default
+        m_levelLength = pl->m_levelLength;
+        if (m_levelLength < 100) m_levelLength = 5000; // Default
         
         // Try to get objects from m_objects
         if (pl->m_objects) {
             int count = pl->m_objects->count();
             LOGI("m_objects count: {}", count);
+            m_raw.reserve(count);
             
             for (int i = 0; i < count; i++) {
                 auto obj = static_cast<GameObject*>(pl->m_objects->objectAtIndex(i));
@@ -122,7 +161,7 @@ public:
         }
         
         // Try batchNodePlayer
-        if (objects.empty() && pl->m_batchNodePlayer) {
+        if (m_raw.empty() && pl->m_batchNodePlayer) {
             LOGI("Trying m_batchNodePlayer...");
             auto children = pl->m_batchNodePlayer->getChildren();
             if (children) {
@@ -131,27 +170,94 @@ public:
         }
         
         // Try object layer
-        if (objects.empty() && pl->m_objectLayer) {
+        if (m_raw.empty() && pl->m_objectLayer) {
             LOGI("Trying m_objectLayer...");
             scanNode(pl->m_objectLayer);
         }
         
         // Last resort: scan everything
-        if (objects.empty()) {
+        if (m_raw.empty()) {
             LOGI("Scanning all children...");
             scanNode(pl);
         }
         
-        loaded = objects.size() > 0;
+        resolvePivots();
+        LOGI("=== SNAPSHOT TAKEN: {} objects, {} triggers ===", m_raw.size(), m_triggers.size());
+        if (m_skippedTriggers) {
+            LOGW("Ignoring {} spawn or touch triggered triggers", m_skippedTriggers);
+        }
         
-        LOGI("=== ANALYSIS COMPLETE ===");
-        LOGI("Total objects found: {}", objects.size());
-        LOGI("Hazards: {}", std::count_if(objects.begin(), objects.end(), [](auto& o) { return o.isHazard; }));
-        LOGI("Solids: {}", std::count_if(objects.begin(), objects.end(), [](auto& o) { return o.isSolid; }));
-        LOGI("Level length: {}", levelLength);
+        // Keep a copy the headless tools can load
+        auto exportPath = Mod::get()->getSaveDir() / "last-level.txt";
+        stream = std::make_shared<LevelStream>();
+        stream->start(std::move(m_raw), std::move(m_triggers), m_levelLength, [cachePath, key, exportPath](const Level& built) {
+            LOGI("=== ANALYSIS COMPLETE ===");
+            built.logSummary();
+            
+            if (!built.objects.empty() && saveLevelCache(cachePath, built, key)) {
+                LOGI("Cached level to {}", cachePath.string());
+            }
+            if (saveLevelText(exportPath, built)) {
+                LOGI("Exported level to {}", exportPath.string());
+            }
+        });
+        m_raw = {};
+        m_triggers = {};
+        m_groupPos = {};
     }
     
+    // Picks up the level once its stream has finished. Main thread only.
+    void poll() {
+        if (!stream || !stream->complete()) return;
+        level = stream->latest();
+        loaded = !level->objects.empty();
+        stream.reset();
+    }
+
 private:
+    // Bump whenever processObject() classifies objects differently, so
+    // caches written by older builds are rebuilt
+    static constexpr uint64_t EXTRACTOR_VERSION = 4;
+    
+    // Trigger object IDs
+    static constexpr int MOVE_TRIGGER = 901;
+    static constexpr int ROTATE_TRIGGER = 1346;
+    static constexpr int TOGGLE_TRIGGER = 1049;
+    static constexpr int ALPHA_TRIGGER = 1007;
+    
+    std::vector<RawObject> m_raw;
+    std::vector<RawTrigger> m_triggers;
+    float m_levelLength = 0;
+    
+    // Rotate triggers waiting for the position of their centre group, and
+    // where the first object of each group sits. Centres are usually
+    // decoration, so every grouped object is recorded before it is dropped.
+    std::vector<std::pair<size_t, int>> m_pivots;
+    std::unordered_map<int, CCPoint> m_groupPos;
+    size_t m_skippedTriggers = 0;
+    
+    // Level ID alone isn't enough: editor levels share ID 0 and online
+    // levels can be updated, so the key also covers the level string and
+    // any object table overrides
+    static uint64_t cacheKey(PlayLayer* pl) {
+        uint64_t key = hashBytes(&EXTRACTOR_VERSION, sizeof(EXTRACTOR_VERSION));
+        uint64_t table = ObjectTable::get().revision();
+        key = hashBytes(&table, sizeof(table), key);
+        if (pl->m_level) {
+            int id = pl->m_level->m_levelID.value();
+            key = hashBytes(&id, sizeof(id), key);
+            auto& str = pl->m_level->m_levelString;
+            key = hashBytes(str.c_str(), str.size(), key);
+        }
+        int count = pl->m_objects ? pl->m_objects->count() : 0;
+        return hashBytes(&count, sizeof(count), key);
+    }
+    
+    static std::filesystem::path cachePathFor(PlayLayer* pl, uint64_t key, const char* dir, const char* ext) {
+        int id = pl->m_level ? pl->m_level->m_levelID.value() : 0;
+        return Mod::get()->getSaveDir() / dir / fmt::format("{}-{:016x}.{}", id, key, ext);
+    }
+    
     void scanNode(CCNode* node) {
         if (!node) return;
         
@@ -171,6 +277,9 @@ private:
         }
     }
     
+    // Copies what classification needs and nothing else, so the main
+    // thread spends as little time per object as possible. Triggers are
+    // captured here too; other decoration is dropped with one table lookup.
     void processObject(GameObject* obj) {
         if (!obj) return;
         
@@ -178,271 +287,288 @@ private:
         if (id <= 0) return;
         
         auto pos = obj->getPosition();
-        auto size = obj->getContentSize();
-        float scaleX = std::abs(obj->getScaleX());
-        float scaleY = std::abs(obj->getScaleY());
-        
-        float w = size.width * scaleX;
-        float h = size.height * scaleY;
-        if (w < 1) w = Physics::BLOCK;
-        if (h < 1) h = Physics::BLOCK;
-        
-        LevelObject lo;
-        lo.id = id;
-        lo.x = pos.x;
-        lo.y = pos.y;
-        lo.w = w;
-        lo.h = h;
-        
-        // Check if hazard (spikes, saws)
-        lo.isHazard = (id == 8 || id == 39 || id == 103 || id == 135 || 
-                       id == 140 || id == 1332 || id == 1333 || id == 1334 ||
-                       id == 88 || id == 89 || id == 98 || id == 397);
+        if (pos.x > m_levelLength) {
+            m_levelLength = pos.x;
+        }
         
-        // Check if solid block
-        lo.isSolid = (id >= 1 && id <= 7) || (id >= 40 && id <= 50);
+        GroupList groups;
+        if (obj->m_groups && obj->m_groupCount > 0) {
+            groups.count = static_cast<uint8_t>(std::min<int>(obj->m_groupCount, GroupList::MAX));
+            for (int g = 0; g < groups.count; g++) {
+                groups.ids[g] = static_cast<uint16_t>(obj->m_groups->at(g));
+                m_groupPos.try_emplace(groups.ids[g], pos);
+            }
+        }
         
-        if (lo.isHazard || lo.isSolid) {
-            objects.push_back(lo);
+        switch (id) {
+            case MOVE_TRIGGER: return processTrigger(obj, TriggerKind::Move, pos);
+            case ROTATE_TRIGGER: return processTrigger(obj, TriggerKind::Rotate, pos);
+            case TOGGLE_TRIGGER: return processTrigger(obj, TriggerKind::Toggle, pos);
+            case ALPHA_TRIGGER: return processTrigger(obj, TriggerKind::Alpha, pos);
+        }
+        if (ObjectTable::get().lookup(id).kind == ObjectKind::None) return;
+        
+        RawObject raw;
+        raw.id = id;
+        raw.place.x = pos.x;
+        raw.place.y = pos.y;
+        raw.place.scaleX = obj->getScaleX();
+        raw.place.scaleY = obj->getScaleY();
+        raw.place.rotation = obj->getRotation();
+        raw.place.flipX = obj->m_isFlipX;
+        raw.place.flipY = obj->m_isFlipY;
+        raw.groups = groups;
+        m_raw.push_back(raw);
+    }
+    
+    // Only triggers fired by the player passing them can be placed on the
+    // x axis; spawn and touch triggered ones are counted and skipped
+    void processTrigger(GameObject* obj, TriggerKind kind, const CCPoint& pos) {
+        auto effect = typeinfo_cast<EffectGameObject*>(obj);
+        if (!effect) return;
+        if (effect->m_isSpawnTriggered || effect->m_isTouchTriggered) {
+            m_skippedTriggers++;
+            return;
         }
         
-        if (pos.x > levelLength) {
-            levelLength = pos.x;
+        RawTrigger t;
+        t.kind = kind;
+        t.x = pos.x;
+        t.group = effect->m_targetGroupID;
+        t.duration = effect->m_duration;
+        switch (kind) {
+            case TriggerKind::Move:
+                t.dx = effect->m_moveOffset.x;
+                t.dy = effect->m_moveOffset.y;
+                break;
+            case TriggerKind::Rotate:
+                t.degrees = effect->m_rotationDegrees + 360.0f * effect->m_times360;
+                if (effect->m_centerGroupID > 0) m_pivots.push_back({m_triggers.size(), effect->m_centerGroupID});
+                break;
+            case TriggerKind::Toggle:
+                t.duration = 0;
+                t.activate = effect->m_activateGroup;
+                break;
+            case TriggerKind::Alpha:
+                break;
+        }
+        m_triggers.push_back(t);
+    }
+    
+    // A centre group with no objects leaves its triggers turning in place
+    void resolvePivots() {
+        for (auto [index, group] : m_pivots) {
+            auto it = m_groupPos.find(group);
+            if (it == m_groupPos.end()) continue;
+            auto& t = m_triggers[index];
+            t.hasPivot = true;
+            t.pivotX = it->second.x;
+            t.pivotY = it->second.y;
         }
+        m_pivots.clear();
     }
 };
 
 // ============================================================================
-// SIMPLE PATHFINDER
+// REPLAY
 // ============================================================================
 
-class SimplePathfinder {
+class SimpleReplay {
 public:
-    std::atomic<bool> running{false};
-    std::atomic<bool> found{false};
-    std::atomic<float> progress{0};
-    std::vector<bool> solution;
-    std::mutex mtx;
-    std::thread worker;
-    
-    static SimplePathfinder& get() {
-        static SimplePathfinder instance;
+    Replay replay;
+    ReplayCursor cursor;
+    bool playing = false;
+    
+    // Replay ticks are driven by game time, not rendered frames
+    TickClock clock;
+    uint32_t tick = 0;
+    
+    // Live replays follow a running search and grow as more of the
+    // solution gets committed
+    bool live = false;
+    uint32_t liveRun = 0;
+    uint32_t liveVersion = 0;
+    
+    // When set, the simulator runs the same inputs next to the real
+    // player and reports the first tick where the two disagree
+    LockstepVerifier verifier;
+    std::shared_ptr<const Level> verifyLevel;
+    
+    static SimpleReplay& get() {
+        static SimpleReplay instance;
         return instance;
     }
     
-    ~SimplePathfinder() {
-        stop();
+    void load(const std::vector<bool>& inp, int tickRate) {
+        replay.assign(inp);
+        replay.info().tickRate = tickRate;
+        live = false;
+        rewind();
+        LOGI("Loaded {} inputs at {} ticks/s ({} bytes encoded)", replay.frames(), tickRate, replay.encodedSize());
     }
     
-    void start() {
-        if (running) return;
-        
-        auto& analyzer = LevelAnalyzer::get();
-        if (!analyzer.loaded) {
-            LOGE("Level not analyzed!");
-            return;
+    bool loadFile(const std::filesystem::path& path) {
+        if (!replay.load(path)) return false;
+        live = false;
+        rewind();
+        LOGI("Loaded {} inputs at {} ticks/s from {}", replay.frames(), replay.info().tickRate, path.string());
+        return true;
+    }
+    
+    bool save(const std::filesystem::path& path, int levelId, uint64_t levelHash) {
+        replay.info().levelId = levelId;
+        replay.info().levelHash = levelHash;
+        return replay.save(path);
+    }
+    
+    void loadLive(const SearchSnapshot& snap) {
+        replay.assign(snap.prefix, snap.committed);
+        replay.info().tickRate = snap.tickRate;
+        live = true;
+        liveRun = snap.run;
+        liveVersion = snap.version;
+        rewind();
+        LOGI("Loaded {} committed inputs (search still running)", replay.frames());
+    }
+    
+    // Picks up newly committed inputs from the search that loadLive() used.
+    // A run's committed prefix only ever grows, so re-encoding it and
+    // seeking back to the current tick continues seamlessly.
+    void follow(const SearchSnapshot& snap) {
+        if (!live || snap.run != liveRun || snap.version == liveVersion) return;
+        liveVersion = snap.version;
+        
+        if (snap.committed > replay.frames()) {
+            replay.assign(snap.prefix, snap.committed);
+            cursor = replay.cursorAt(tick);
         }
-        
-        running = true;
-        found = false;
-        progress = 0;
-        solution.clear();
-        
-        worker = std::thread([this]() {
-            findPath();
-        });
+        if (snap.finished) live = false;
+    }
+    
+    void start() {
+        playing = true;
+        rewind();
     }
     
     void stop() {
-        running = false;
-        if (worker.joinable()) {
-            worker.join();
-        }
+        playing = false;
     }
     
-private:
-    void findPath() {
-        LOGI("Pathfinder thread started");
-        
-        auto& analyzer = LevelAnalyzer::get();
-        float levelLen = analyzer.levelLength + 100;
-        
-        // Simple simulation
-        std::vector<std::pair<SimState, std::vector<bool>>> beam;
-        
-        SimState initial;
-        beam.push_back({initial, {}});
-        
-        int maxFrames = 50000;
-        float bestX = 0;
-        
-        for (int frame = 0; frame < maxFrames && running; frame++) {
-            std::vector<std::pair<SimState, std::vector<bool>>> nextBeam;
-            
-            for (auto& [state, inputs] : beam) {
-                if (state.dead) continue;
-                
-                if (state.x >= levelLen - 50) {
-                    std::lock_guard<std::mutex> lock(mtx);
-                    solution = inputs;
-                    found = true;
-                    running = false;
-                    LOGI("Path found! {} inputs", solution.size());
-                    return;
-                }
-                
-                // Try both inputs
-                for (int inp = 0; inp < 2; inp++) {
-                    bool click = (inp == 1);
-                    
-                    SimState ns = state;
-                    std::vector<bool> ni = inputs;
-                    
-                    // Simulate one frame
-                    simulateFrame(ns, click, analyzer);
-                    ni.push_back(click);
-                    
-                    if (!ns.dead) {
-                        nextBeam.push_back({ns, ni});
-                    }
-                }
-            }
-            
-            if (nextBeam.empty()) {
-                LOGE("All states dead at frame {}", frame);
-                break;
-            }
-            
-            // Sort by x position
-            std::sort(nextBeam.begin(), nextBeam.end(),
-                [](auto& a, auto& b) { return a.first.x > b.first.x; });
-            
-            // Keep best states
-            if (nextBeam.size() > 1000) {
-                nextBeam.resize(1000);
-            }
-            
-            beam = std::move(nextBeam);
-            
-            if (!beam.empty() && beam[0].first.x > bestX) {
-                bestX = beam[0].first.x;
-                progress = bestX / levelLen;
-            }
-            
-            if (frame % 100 == 0) {
-                LOGI("Frame {}, beam size {}, best x {:.0f}", frame, beam.size(), bestX);
-            }
-        }
-        
-        if (!beam.empty()) {
-            std::lock_guard<std::mutex> lock(mtx);
-            solution = beam[0].second;
-        }
-        
-        running = false;
-        LOGI("Pathfinder finished, best progress: {:.1f}%", progress * 100);
+    void rewind() {
+        cursor = replay.cursor();
+        clock.reset(replay.info().tickRate);
+        tick = 0;
+        restartVerifier();
     }
     
-    void simulateFrame(SimState& s, bool click, LevelAnalyzer& analyzer) {
-        float dt = 1.0f / 240.0f;
-        
-        // Apply gravity
-        s.velY -= Physics::GRAVITY * dt * 60;
-        
-        // Jump
-        if (s.onGround && click) {
-            s.velY = Physics::JUMP_VEL;
-            s.onGround = false;
+    // Pass nullptr to play without verification
+    void verify(std::shared_ptr<const Level> level) {
+        verifyLevel = std::move(level);
+        if (verifyLevel) {
+            restartVerifier();
+        } else {
+            verifier.stop();
         }
-        
-        // Move
-        s.y += s.velY * dt * 60;
-        s.x += Physics::XVEL * dt;
-        
-        // Clamp velocity
-        if (s.velY < -20) s.velY = -20;
-        if (s.velY > 20) s.velY = 20;
-        
-        // Ground check
-        if (s.y <= 105) {
-            s.y = 105;
-            s.velY = 0;
-            s.onGround = true;
+    }
+    
+    // Each attempt is verified from the start, after reporting the last one
+    void restartVerifier() {
+        if (!verifyLevel) return;
+        if (verifier.active()) verifier.report();
+        int rate = std::clamp(replay.info().tickRate, BatchPhysics::MIN_TICK_RATE, BatchPhysics::MAX_TICK_RATE);
+        verifier.reset(verifyLevel, BatchPhysics::Tick::at(rate));
+    }
+    
+    // Steps through every replay tick that `dt` seconds of game time cover
+    // and returns whether the button is held; a press on any of them counts
+    bool step(float dt) {
+        if (!playing) return false;
+        
+        int ticks = clock.advance(dt);
+        if (ticks == 0) return cursor.held();
+        
+        bool held = false;
+        for (int i = 0; i < ticks; i++) {
+            held |= cursor.held();
+            verifier.step(cursor.held());
+            cursor.advance();
         }
+        tick += ticks;
         
-        // Collision check
-        HitRect player = {s.x - 12, s.y - 12, 24, 24};
-        
-        for (auto& obj : analyzer.objects) {
-            if (obj.x < s.x - 100) continue;
-            if (obj.x > s.x + 100) break;
-            
-            HitRect objRect = {obj.x - obj.w/2, obj.y - obj.h/2, obj.w, obj.h};
-            
-            if (player.intersects(objRect)) {
-                if (obj.isHazard) {
-                    s.dead = true;
-                    return;
-                }
-                
-                if (obj.isSolid) {
-                    // Simple collision resolution
-                    float overlapY = (player.y + player.h) - objRect.y;
-                    if (overlapY > 0 && overlapY < 20 && s.velY <= 0) {
-                        s.y = objRect.y + objRect.h + 12;
-                        s.velY = 0;
-                        s.onGround = true;
-                    }
-                }
-            }
+        // A live replay keeps going and waits for more inputs
+        if (cursor.done() && !live) {
+            playing = false;
         }
-        
-        s.frame++;
+        return held;
     }
 };
 
 // ============================================================================
-// REPLAY
+// ATTEMPT RECORDER
 // ============================================================================
 
-class SimpleReplay {
+// Records the player's own attempts at a level, sampled once per tick at
+// the search's tick rate, and keeps the one that got furthest. A search
+// can start from it and only has to solve what the player couldn't.
+// Practice attempts start from checkpoints and aren't recorded.
+class AttemptRecorder {
 public:
-    std::vector<bool> inputs;
-    size_t frame = 0;
-    bool playing = false;
+    // Jump button state, kept up to date by the button hook
+    bool held = false;
     
-    static SimpleReplay& get() {
-        static SimpleReplay instance;
+    static AttemptRecorder& get() {
+        static AttemptRecorder instance;
         return instance;
     }
     
-    void load(const std::vector<bool>& inp) {
-        inputs = inp;
-        frame = 0;
-        LOGI("Loaded {} inputs", inputs.size());
+    // Ends the current attempt and starts the next one. Attempts on
+    // another level discard everything recorded so far.
+    void restart(int levelId, int tickRate) {
+        if (levelId != m_levelId) {
+            m_levelId = levelId;
+            m_best.clear();
+            m_bestX = 0;
+        } else {
+            keepIfBest();
+        }
+        m_inputs.clear();
+        m_x = 0;
+        m_clock.reset(tickRate);
     }
     
-    void start() {
-        playing = true;
-        frame = 0;
+    void step(float dt, float x) {
+        int ticks = m_clock.advance(dt);
+        m_inputs.insert(m_inputs.end(), ticks, held);
+        m_x = x;
     }
     
-    void stop() {
-        playing = false;
+    // Best attempt so far, including the one in progress
+    bool best(std::vector<bool>& inputs, int& tickRate) {
+        keepIfBest();
+        if (m_best.empty()) return false;
+        inputs = m_best;
+        tickRate = m_bestRate;
+        return true;
     }
     
-    bool getInput() {
-        if (!playing || frame >= inputs.size()) return false;
-        return inputs[frame];
+    float bestX() const {
+        return std::max(m_bestX, m_x);
     }
+
+private:
+    int m_levelId = -1;
+    TickClock m_clock;
+    std::vector<bool> m_inputs;
+    float m_x = 0;
+    std::vector<bool> m_best;
+    float m_bestX = 0;
+    int m_bestRate = Physics::TICK_RATE;
     
-    void advance() {
-        if (playing) {
-            frame++;
-            if (frame >= inputs.size()) {
-                playing = false;
-            }
-        }
+    void keepIfBest() {
+        if (m_inputs.empty() || m_x <= m_bestX) return;
+        m_best = m_inputs;
+        m_bestX = m_x;
+        m_bestRate = m_clock.rate();
     }
 };
 
@@ -453,6 +579,8 @@ public:
 class PFPopup : public geode::Popup<> {
 protected:
     CCLabelBMFont* m_label = nullptr;
+    CCLabelBMFont* m_statsLabel = nullptr;
+    ButtonSprite* m_findSprite = nullptr;
     
     bool setup() override {
         setTitle("Pathfinder");
@@ -462,27 +590,48 @@ protected:
         m_label->setPosition({0, 20});
         m_mainLayer->addChild(m_label);
         
+        // Per-phase search counters
+        m_statsLabel = CCLabelBMFont::create("", "chatFont.fnt");
+        m_statsLabel->setScale(0.5f);
+        m_statsLabel->setPosition({0, -52});
+        m_mainLayer->addChild(m_statsLabel);
+        
         auto analyzeBtn = CCMenuItemSpriteExtra::create(
-            ButtonSprite::create("Analyze", "goldFont.fnt", "GJ_button_01.png", 0.8f),
+            ButtonSprite::create("Analyze", "goldFont.fnt", "GJ_button_01.png", 0.6f),
             this, menu_selector(PFPopup::onAnalyze)
         );
-        analyzeBtn->setPosition({-70, -20});
+        analyzeBtn->setPosition({-128, -20});
         
+        // Stops the search while one is running
+        m_findSprite = ButtonSprite::create("Find", "goldFont.fnt", "GJ_button_01.png", 0.6f);
         auto findBtn = CCMenuItemSpriteExtra::create(
-            ButtonSprite::create("Find", "goldFont.fnt", "GJ_button_01.png", 0.8f),
-            this, menu_selector(PFPopup::onFind)
+            m_findSprite, this, menu_selector(PFPopup::onFind)
+        );
+        findBtn->setPosition({-64, -20});
+        
+        auto resumeBtn = CCMenuItemSpriteExtra::create(
+            ButtonSprite::create("Resume", "goldFont.fnt", "GJ_button_01.png", 0.6f),
+            this, menu_selector(PFPopup::onResume)
+        );
+        resumeBtn->setPosition({0, -20});
+        
+        auto resolveBtn = CCMenuItemSpriteExtra::create(
+            ButtonSprite::create("Re-solve", "goldFont.fnt", "GJ_button_01.png", 0.6f),
+            this, menu_selector(PFPopup::onResolve)
         );
-        findBtn->setPosition({0, -20});
+        resolveBtn->setPosition({64, -20});
         
         auto playBtn = CCMenuItemSpriteExtra::create(
-            ButtonSprite::create("Play", "goldFont.fnt", "GJ_button_01.png", 0.8f),
+            ButtonSprite::create("Play", "goldFont.fnt", "GJ_button_01.png", 0.6f),
             this, menu_selector(PFPopup::onPlay)
         );
-        playBtn->setPosition({70, -20});
+        playBtn->setPosition({128, -20});
         
         auto menu = CCMenu::create();
         menu->addChild(analyzeBtn);
         menu->addChild(findBtn);
+        menu->addChild(resumeBtn);
+        menu->addChild(resolveBtn);
         menu->addChild(playBtn);
         menu->setPosition({0, 0});
         m_mainLayer->addChild(menu);
@@ -495,19 +644,32 @@ protected:
     void onUpdate(float dt) {
         auto& pf = SimplePathfinder::get();
         auto& analyzer = LevelAnalyzer::get();
+        auto& snap = pf.latest();
+        analyzer.poll();
         
         std::string text;
-        if (pf.running) {
-            text = fmt::format("Finding: {:.1f}%", pf.progress * 100);
-        } else if (pf.found) {
-            text = fmt::format("Found! {} inputs", pf.solution.size());
+        if (pf.stopping()) {
+            text = "Stopping...";
+        } else if (pf.busy()) {
+            text = fmt::format("Finding: {:.1f}% ({} ready)", snap.progress * 100, snap.committed);
+        } else if (snap.found) {
+            text = snap.margin >= 0
+                ? fmt::format("Found! {} inputs, {} ticks leeway", snap.solution().size(), snap.margin)
+                : fmt::format("Found! {} inputs", snap.prefix.size());
+        } else if (analyzer.stream) {
+            float built = std::min(1.0f, analyzer.stream->readyX() / analyzer.stream->levelLength());
+            text = fmt::format("Analyzing: {:.0f}%", built * 100);
         } else if (analyzer.loaded) {
-            text = fmt::format("Analyzed: {} objects", analyzer.objects.size());
+            text = fmt::format("Analyzed: {} objects", analyzer.level->objects.size());
         } else {
             text = "Click Analyze first";
         }
         
         m_label->setString(text.c_str());
+        m_findSprite->setString(pf.busy() ? "Stop" : "Find");
+        
+        auto stats = snap.stats.expanded > 0 ? snap.stats.summary() : std::string();
+        m_statsLabel->setString(stats.c_str());
     }
     
     void onAnalyze(CCObject*) {
@@ -520,28 +682,127 @@ protected:
     }
     
     void onFind(CCObject*) {
-        if (!LevelAnalyzer::get().loaded) {
+        // The search winds down on its own thread; the popup may be gone
+        // by the time it has
+        auto& pf = SimplePathfinder::get();
+        if (pf.busy()) {
+            pf.requestStop([]() {
+                geode::queueInMainThread([]() {
+                    Notification::create("Search stopped", NotificationIcon::Info)->show();
+                });
+            });
+            return;
+        }
+        
+        auto& analyzer = LevelAnalyzer::get();
+        analyzer.poll();
+        if (!analyzer.loaded && !analyzer.stream) {
+            FLAlertLayer::create("Error", "Analyze first!", "OK")->show();
+            return;
+        }
+        auto cfg = configFromSettings();
+        cfg.checkpointPath = analyzer.checkpointPath;
+        
+        // A level still being built is searched as it arrives
+        if (analyzer.loaded) {
+            pf.start(analyzer.level, cfg);
+        } else {
+            pf.start(analyzer.stream, cfg);
+        }
+    }
+    
+    void onResume(CCObject*) {
+        auto& analyzer = LevelAnalyzer::get();
+        analyzer.poll();
+        if (!analyzer.loaded) {
+            FLAlertLayer::create("Error", "Analyze first!", "OK")->show();
+            return;
+        }
+        if (SimplePathfinder::get().busy()) return;
+        
+        auto cfg = configFromSettings();
+        cfg.checkpointPath = analyzer.checkpointPath;
+        if (!SimplePathfinder::get().start(analyzer.level, cfg, true)) {
+            FLAlertLayer::create("Error", "No saved search for this level!", "OK")->show();
+        }
+    }
+    
+    // Searches along the last solution, or the player's best attempt if
+    // there is none, and only branches where it stops working. After a
+    // small level edit that re-solves just the edited part.
+    void onResolve(CCObject*) {
+        auto& analyzer = LevelAnalyzer::get();
+        analyzer.poll();
+        if (!analyzer.loaded) {
             FLAlertLayer::create("Error", "Analyze first!", "OK")->show();
             return;
         }
-        SimplePathfinder::get().start();
+        auto& pf = SimplePathfinder::get();
+        if (pf.busy()) return;
+        
+        auto cfg = configFromSettings();
+        cfg.checkpointPath = analyzer.checkpointPath;
+        
+        // Seeds only replay correctly at the rate they were made at
+        std::vector<bool> seed;
+        int seedRate = 0;
+        auto& snap = pf.latest();
+        Replay saved;
+        if (snap.found && !snap.prefix.empty()) {
+            seed = snap.solution();
+            seedRate = snap.tickRate;
+        } else if (!analyzer.replayPath.empty() && saved.load(analyzer.replayPath)) {
+            seed = saved.inputs();
+            seedRate = saved.info().tickRate;
+        } else if (AttemptRecorder::get().best(seed, seedRate)) {
+            LOGI("Starting from your best attempt (x {:.0f})", AttemptRecorder::get().bestX());
+        } else {
+            FLAlertLayer::create("Error", "No solution or attempt to start from!", "OK")->show();
+            return;
+        }
+        if (seedRate != cfg.tickRate) {
+            FLAlertLayer::create("Error", "The solution was made at another tick rate!", "OK")->show();
+            return;
+        }
+        pf.start(analyzer.level, cfg, std::move(seed));
     }
     
     void onPlay(CCObject*) {
         auto& pf = SimplePathfinder::get();
-        if (pf.found && !pf.solution.empty()) {
-            SimpleReplay::get().load(pf.solution);
-            SimpleReplay::get().start();
+        auto& snap = pf.latest();
+        auto& analyzer = LevelAnalyzer::get();
+        analyzer.poll();
+        auto& replay = SimpleReplay::get();
+        bool verify = Mod::get()->getSettingValue<bool>("verify-replays") && analyzer.loaded;
+        if (snap.found && !snap.prefix.empty()) {
+            replay.load(snap.solution(), snap.tickRate);
+            if (analyzer.loaded && !analyzer.replayPath.empty() &&
+                replay.save(analyzer.replayPath, analyzer.levelId, hashLevel(*analyzer.level))) {
+                LOGI("Saved replay to {}", analyzer.replayPath.string());
+            }
+            replay.start();
+            replay.verify(verify ? analyzer.level : nullptr);
+            onClose(nullptr);
+        } else if (pf.busy() && snap.committed > 0) {
+            // Start watching the part that is already solved
+            replay.loadLive(snap);
+            replay.start();
+            replay.verify(verify ? analyzer.level : nullptr);
+            onClose(nullptr);
+        } else if (!pf.busy() && !analyzer.replayPath.empty() && replay.loadFile(analyzer.replayPath)) {
+            // Solved in an earlier session
+            replay.start();
+            replay.verify(verify ? analyzer.level : nullptr);
             onClose(nullptr);
         } else {
             FLAlertLayer::create("Error", "No path found!", "OK")->show();
         }
     }
-    
+
 public:
     static PFPopup* create() {
         auto ret = new PFPopup();
-        if (ret->initAnchored(280, 140)) {
+        if (ret->initAnchored(340, 140)) {
             ret->autorelease();
             return ret;
         }
@@ -561,9 +822,14 @@ class $modify(MyPlayLayer, PlayLayer) {
     
     void update(float dt) {
         auto& replay = SimpleReplay::get();
+        bool verifying = replay.playing && replay.verifier.active();
+        
+        if (replay.playing && replay.live) {
+            replay.follow(SimplePathfinder::get().latest());
+        }
         
         if (replay.playing && m_player1) {
-            bool inp = replay.getInput();
+            bool inp = replay.step(dt);
             
             if (inp && !m_fields->inputHeld) {
                 m_fields->inputHeld = true;
@@ -575,24 +841,47 @@ class $modify(MyPlayLayer, PlayLayer) {
             } else if (!inp) {
                 m_fields->inputHeld = false;
             }
-            
-            replay.advance();
         }
         
         PlayLayer::update(dt);
+        
+        // The player's own attempts, for seeding a search
+        if (!replay.playing && !m_isPracticeMode && m_player1) {
+            AttemptRecorder::get().step(dt, m_player1->getPositionX());
+        }
+        
+        // The game has now run the ticks the simulator just ran
+        if (verifying && m_player1) {
+            auto pos = m_player1->getPosition();
+            replay.verifier.observe(pos.x, pos.y, static_cast<float>(m_player1->m_yVelocity));
+            if (!replay.playing) {
+                replay.verifier.report();
+                replay.verifier.stop();
+            }
+        }
     }
     
     void resetLevel() {
         PlayLayer::resetLevel();
         m_fields->inputHeld = false;
+        AttemptRecorder::get().restart(m_level ? m_level->m_levelID.value() : 0,
+                                       static_cast<int>(Mod::get()->getSettingValue<int64_t>("tick-rate")));
         
         auto& replay = SimpleReplay::get();
         if (replay.playing) {
-            replay.frame = 0;
+            replay.rewind();
         }
     }
 };
 
+// Jump presses of player 1, for the attempt recorder
+class $modify(MyBaseGameLayer, GJBaseGameLayer) {
+    void handleButton(bool down, int button, bool isPlayer1) {
+        GJBaseGameLayer::handleButton(down, button, isPlayer1);
+        if (button == 1 && isPlayer1) AttemptRecorder::get().held = down;
+    }
+};
+
 // Add button to pause menu instead of level info
 class $modify(MyPauseLayer, PauseLayer) {
     void customSetup() {
@@ -642,5 +931,6 @@ class $modify(MyMenuLayer, MenuLayer) {
 };
 
 $on_mod(Loaded) {
+    Log::setSink(geodeLogSink);
     LOGI("=== GD Pathfinder Loaded ===");
 }
\ No newline at end of file